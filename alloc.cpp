@@ -0,0 +1,198 @@
+#include "alloc.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HUGEPAGE (2 * 1024 * 1024)
+#define MPOL_INTERLEAVE_ (3)    // from <numaif.h>, which needs libnuma
+
+
+/**
+ * numaNodes: the number of NUMA nodes the kernel knows of (1 if it cannot
+ * tell).
+ */
+int numaNodes()
+{
+    int first, last, nodes = 1;
+    FILE *in = fopen("/sys/devices/system/node/possible", "r");
+
+    if(in != NULL)
+    {
+        if(fscanf(in, "%d-%d", &first, &last) == 2 && last >= first)
+        {
+            nodes = last - first + 1;
+        }
+        fclose(in);
+    }
+    return nodes;
+}
+
+/**
+ * interleave: asks the kernel to spread the pages of a mapping round-robin
+ * over every node, so that threads on all nodes see the same average
+ * latency instead of all of them hammering one node's memory.
+ */
+static bool interleave(void *block, size_t bytes, int nodes)
+{
+    unsigned long mask[4] = { 0, 0, 0, 0 };
+
+    if(nodes > (int)(8 * sizeof(mask)))
+    {
+        nodes = 8 * sizeof(mask);
+    }
+    for(int i = 0; i < nodes; i++)
+    {
+        mask[i / (8 * sizeof(long))] |= 1UL << (i % (8 * sizeof(long)));
+    }
+    return syscall(SYS_mbind, block, bytes, MPOL_INTERLEAVE_, mask,
+                   (unsigned long)nodes + 1, 0) == 0;
+}
+
+/**
+ * bigAlloc: allocates a block for one of the large tables. With
+ * ALLOC_HUGEPAGES explicit huge pages are tried first, then an ordinary
+ * mapping marked for transparent huge pages; with ALLOC_INTERLEAVE and more
+ * than one NUMA node the pages are interleaved. If mapping fails altogether
+ * the block comes from malloc(). The memory is not touched.
+ *
+ * return: the block, or NULL if even malloc() fails.
+ */
+void *bigAlloc(size_t bytes, int flags, AllocInfo &info)
+{
+    void *block = MAP_FAILED;
+    size_t rounded = (bytes + HUGEPAGE - 1) / HUGEPAGE * HUGEPAGE;
+
+    info.bytes = bytes;
+    info.mapped = 0;
+    info.hugetlb = false;
+    info.thp = false;
+    info.nodes = 1;
+
+#ifdef MAP_HUGETLB
+    if(flags & ALLOC_HUGEPAGES)
+    {
+        block = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        info.hugetlb = (block != MAP_FAILED);
+    }
+#endif
+    if(block == MAP_FAILED)
+    {
+        block = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if(block == MAP_FAILED)
+    {
+        WARN(__FILE__, __LINE__, "mmap of %lu bytes failed, using malloc",
+             (unsigned long)bytes);
+        return malloc(bytes);
+    }
+    info.mapped = rounded;
+
+#ifdef MADV_HUGEPAGE
+    if((flags & ALLOC_HUGEPAGES) && !info.hugetlb)
+    {
+        info.thp = (madvise(block, rounded, MADV_HUGEPAGE) == 0);
+    }
+#endif
+
+    int nodes = numaNodes();
+    if((flags & ALLOC_INTERLEAVE) && nodes > 1)
+    {
+        if(interleave(block, rounded, nodes))
+        {
+            info.nodes = nodes;
+        }
+        else
+        {
+            WARN(__FILE__, __LINE__, "could not interleave over %d nodes",
+                 nodes);
+        }
+    }
+    return block;
+}
+
+void bigFree(void *block, const AllocInfo &info)
+{
+    if(block == NULL)
+    {
+        return;
+    }
+    if(info.mapped)
+    {
+        munmap(block, info.mapped);
+    }
+    else
+    {
+        free(block);
+    }
+}
+
+/**
+ * hugeBytes: how much of the mapping at `block' is currently backed by
+ * transparent huge pages, from /proc/self/smaps. The kernel merges adjacent
+ * mappings with the same flags, so the count is capped at `mapped'.
+ */
+static size_t hugeBytes(void *block, size_t mapped)
+{
+    char line[256];
+    unsigned long start, end, kb;
+    bool inside = false;
+    size_t total = 0;
+    FILE *in = fopen("/proc/self/smaps", "r");
+
+    if(in == NULL)
+    {
+        return 0;
+    }
+    while(fgets(line, sizeof(line), in))
+    {
+        if(sscanf(line, "%lx-%lx ", &start, &end) == 2)
+        {
+            inside = (start <= (unsigned long)block &&
+                      (unsigned long)block < end);
+        }
+        else if(inside && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+        {
+            total += (size_t)kb * 1024;
+        }
+    }
+    fclose(in);
+    return (total < mapped) ? total : mapped;
+}
+
+/**
+ * describeAlloc: one line saying what a block got, for the startup log.
+ * Transparent huge pages only appear once the memory has been touched.
+ */
+string describeAlloc(void *block, const AllocInfo &info)
+{
+    ostringstream out;
+
+    out << info.bytes / 1000000 << " MB";
+    if(!info.mapped)
+    {
+        out << " from malloc";
+    }
+    else if(info.hugetlb)
+    {
+        out << " in " << info.mapped / HUGEPAGE << " explicit huge pages";
+    }
+    else if(info.thp)
+    {
+        out << ", " << hugeBytes(block, info.mapped) / 1000000
+            << " MB in transparent huge pages";
+    }
+    else
+    {
+        out << " in ordinary pages";
+    }
+    if(info.nodes > 1)
+    {
+        out << ", interleaved over " << info.nodes << " NUMA nodes";
+    }
+    return out.str();
+}
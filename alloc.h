@@ -0,0 +1,31 @@
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+#include <string>
+#include "common.h"
+
+#define ALLOC_HUGEPAGES (1)     // back the block with huge pages if possible
+#define ALLOC_INTERLEAVE (2)    // spread the block over all NUMA nodes
+#define ALLOC_DEFAULT (ALLOC_HUGEPAGES)
+
+using namespace std;
+
+/**
+ * AllocInfo: how a large block was actually obtained.
+ */
+struct AllocInfo
+{
+    size_t bytes;           // usable size requested
+    size_t mapped;          // size of the mapping, 0 if it came from malloc
+    bool hugetlb;           // explicit huge pages (MAP_HUGETLB)
+    bool thp;               // transparent huge pages were requested
+    int nodes;              // NUMA nodes the block is interleaved over
+};
+
+void *bigAlloc(size_t bytes, int flags, AllocInfo &info);
+void bigFree(void *block, const AllocInfo &info);
+string describeAlloc(void *block, const AllocInfo &info);
+
+int numaNodes();
+
+#endif
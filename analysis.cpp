@@ -0,0 +1,188 @@
+#include "analysis.h"
+#include "search.h"
+#include <algorithm>
+#include <cstring>
+
+
+/**
+ * RootMove: a root move as seen by one iteration. A move that fails low
+ * against the multi-PV window only has an upper bound for a score and is
+ * ranked below every exact one.
+ */
+struct RootMove
+{
+    MoveAnalysis analysis;
+    bool exact;
+};
+
+static bool betterRootMove(const RootMove &a, const RootMove &b)
+{
+    if(a.exact != b.exact)
+    {
+        return a.exact;
+    }
+    return a.analysis.score > b.analysis.score;
+}
+
+/**
+ * analyzePosition: scores the moves of `side' in `board' without touching
+ * any Player. With limits.multipv = N only the N best moves are scored
+ * exactly; the rest are refuted with a null window against the N-th best.
+ * Every iteration after the first searches each move in an aspiration
+ * window around its previous score. Results are shared through `cache' if
+ * one is given.
+ *
+ * return: true; `result' holds the moves of the deepest completed
+ * iteration, best first.
+ */
+bool analyzePosition(Board board, Side side, AnalysisLimits limits,
+                     AnalysisResult &result, SearchCache *cache)
+{
+    int list[64], n, i, depth, alpha, exact;
+    int64_t start = nowms();
+    Search search;
+    uint64_t flips;
+    Move move(0, 0);
+    vector<RootMove> order, current;
+
+    result.depth = 0;
+    result.nodes = 0;
+    result.moves.clear();
+    search.selective = limits.selective;
+    search.cache = cache;
+
+    n = board.moveList(side, list);
+    for(i = 0; i < n; i++)
+    {
+        RootMove root;
+        root.analysis.square = list[i];
+        root.analysis.score = 0;
+        root.exact = true;
+        order.push_back(root);
+    }
+
+    for(depth = 1; n && depth <= limits.depth; depth++)
+    {
+        // Always finish the first iteration so there is something to report
+        if(depth == 2 && limits.msTime >= 0)
+        {
+            search.setDeadline(start + limits.msTime);
+        }
+
+        current.clear();
+        exact = 0;
+        for(i = 0; i < n; i++)
+        {
+            RootMove root = order[i];
+            move.x = root.analysis.square % 8;
+            move.y = root.analysis.square / 8;
+            flips = board.doMove(&move, side);
+
+            // Scores kept exact so far are sorted, so the N-th best is
+            // the bar a further move has to reach.
+            alpha = -SEARCH_INF;
+            if(limits.multipv > 0 && exact >= limits.multipv)
+            {
+                alpha = current[limits.multipv - 1].analysis.score - 1;
+            }
+
+            // From the second iteration on, follow the move's previous line
+            // and look for its score near the previous one.
+            if(depth > 1 && root.exact)
+            {
+                if(root.analysis.pv.size() > 1)
+                {
+                    search.setGuide(&root.analysis.pv[1],
+                                    (int)root.analysis.pv.size() - 1, 1);
+                }
+                else
+                {
+                    search.setGuide(NULL, 0, 1);
+                }
+                root.analysis.score = -search.aspirate(board, enemyof(side),
+                    depth - 1, -root.analysis.score, -SEARCH_INF, -alpha, 1);
+            }
+            else
+            {
+                search.setGuide(NULL, 0, 1);
+                root.analysis.score = -search.negamax(board, enemyof(side),
+                    depth - 1, -SEARCH_INF, -alpha, 1);
+            }
+            board.undoMove(root.analysis.square, flips);
+            if(search.stopped)
+            {
+                break;
+            }
+
+            root.exact = root.analysis.score > alpha;
+            root.analysis.pv.clear();
+            root.analysis.pv.push_back(root.analysis.square);
+            for(int j = 1; j < search.pvlen[1]; j++)
+            {
+                root.analysis.pv.push_back(search.pv[1][j]);
+            }
+
+            current.push_back(root);
+            stable_sort(current.begin(), current.end(), betterRootMove);
+            exact += root.exact;
+        }
+        if(search.stopped)
+        {
+            break;
+        }
+
+        order = current;
+        result.depth = depth;
+    }
+
+    for(i = 0; i < (int)order.size(); i++)
+    {
+        if(limits.multipv > 0 && i >= limits.multipv)
+        {
+            break;
+        }
+        result.moves.push_back(order[i].analysis);
+    }
+    result.nodes = search.nodes;
+    result.ms = (int)(nowms() - start);
+    return true;
+}
+
+/**
+ * analyzePosition: as above, for a position in the format of
+ * Board::setBoard(): 64 characters, 'b' and 'w' for discs and anything else
+ * for an empty square.
+ *
+ * return: false if the position is shorter than 64 characters.
+ */
+bool analyzePosition(const char *position, Side side, AnalysisLimits limits,
+                     AnalysisResult &result, SearchCache *cache)
+{
+    char data[64];
+    Board board;
+
+    if(strlen(position) < 64)
+    {
+        return false;
+    }
+    memcpy(data, position, 64);
+    board.setBoard(data);
+
+    return analyzePosition(board, side, limits, result, cache);
+}
+
+/**
+ * squareName: "a1".."h8" for a square index x + 8*y, "pass" for PASS.
+ */
+string squareName(int square)
+{
+    string name;
+
+    if(square == PASS)
+    {
+        return "pass";
+    }
+    name += (char)('a' + square % 8);
+    name += (char)('1' + square / 8);
+    return name;
+}
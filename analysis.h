@@ -0,0 +1,52 @@
+#ifndef __ANALYSIS_H__
+#define __ANALYSIS_H__
+
+#include <string>
+#include <vector>
+#include "common.h"
+#include "board.h"
+#include "cache.h"
+
+using namespace std;
+
+/**
+ * AnalysisLimits: how much to analyze. The search deepens one ply at a time
+ * until `depth' is done or `msTime' milliseconds have passed (-1 for no time
+ * limit); the first ply is always completed.
+ */
+struct AnalysisLimits
+{
+    int multipv;        // number of best moves to score exactly, 0 for all
+    int depth;
+    int msTime;
+    bool selective;     // allow ProbCut; false for exact scores
+};
+
+/**
+ * MoveAnalysis: one root move, its score for the side to move and the
+ * principal variation starting with it (square indices x + 8*y, PASS for a
+ * pass).
+ */
+struct MoveAnalysis
+{
+    int square;
+    int score;
+    vector<int> pv;
+};
+
+struct AnalysisResult
+{
+    int depth;                  // deepest completed iteration
+    unsigned long nodes;
+    int ms;
+    vector<MoveAnalysis> moves; // best first; empty if the side must pass
+};
+
+bool analyzePosition(Board board, Side side, AnalysisLimits limits,
+                     AnalysisResult &result, SearchCache *cache = NULL);
+bool analyzePosition(const char *position, Side side, AnalysisLimits limits,
+                     AnalysisResult &result, SearchCache *cache = NULL);
+
+string squareName(int square);
+
+#endif
@@ -0,0 +1,176 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "analysis.h"
+#include "mcts.h"
+#include "network.h"
+#include "probcut.h"
+#include "search.h"
+using namespace std;
+
+/*
+ * Batch position analysis. Every input line holds a position in the format of
+ * Board::setBoard() (64 characters, 'b', 'w' and '-' for empty) followed by
+ * the side to move, 'b' or 'w'. For each position the scored moves are
+ * printed best first with their principal variations. --exact turns off
+ * ProbCut pruning. --network evaluates with the given weights (see
+ * network.h) instead of the classic heuristic; ProbCut then only prunes
+ * with a --probcut file fitted to them. --mcts N instead runs N Monte Carlo
+ * playouts (see mcts.h) on --threads threads and prints each move's share
+ * of them and how often they were won, for comparing playouts per second
+ * with nodes per second.
+ */
+static void usage(const char *name) {
+    cerr << "usage: " << name
+         << " [--multipv N] [--depth D] [--time MS] [--exact]"
+         << " [--probcut FILE] [--cache FILE]" << endl
+         << "       [--network FILE]"
+         << " [--mcts PLAYOUTS [--threads N]] [file]" << endl;
+    exit(-1);
+}
+
+/*
+ * Prints the Monte Carlo statistics of the moves from one position, most
+ * visited first. The playouts are seeded the same way for every position.
+ */
+static void monteCarlo(MonteCarlo &mcts, const char *position, Side side,
+                       int msTime, int lineno) {
+    char squares[64];
+    memcpy(squares, position, 64);
+    Board board;
+    board.setBoard(squares);
+
+    mcts.search(board, side, msTime < 0 ? -1 : nowms() + msTime, 1);
+    cout << "position " << lineno << " playouts " << mcts.playouts
+         << " ms " << mcts.ms << endl;
+
+    const MctsNode &root = mcts.root();
+    vector<pair<int, int> > order;
+    for (int i = 0; i < root.children; i++) {
+        order.push_back(make_pair(-root.child[i].visits, i));
+    }
+    sort(order.begin(), order.end());
+    if (order.empty()) {
+        cout << "  none" << endl;
+    }
+    for (unsigned int i = 0; i < order.size(); i++) {
+        const MctsNode &move = root.child[order[i].second];
+        cout << "  " << squareName(move.square == -1 ? PASS : move.square)
+             << " " << (move.visits ? 50 * move.wins / move.visits : 0)
+             << "% visits " << move.visits << endl;
+    }
+    cout.flush();
+}
+
+int main(int argc, char *argv[]) {
+    AnalysisLimits limits;
+    limits.multipv = 0;
+    limits.depth = 6;
+    limits.msTime = -1;
+    limits.selective = true;
+
+    const char *file = NULL, *cacheFile = NULL;
+    long playouts = 0;
+    int threads = 1;
+    SearchCache cache, *shared = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--multipv") && i + 1 < argc) {
+            limits.multipv = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            limits.depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--time") && i + 1 < argc) {
+            limits.msTime = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--exact")) {
+            limits.selective = false;
+        } else if (!strcmp(argv[i], "--probcut") && i + 1 < argc) {
+            if (!probCut.load(argv[++i])) exit(-1);
+        } else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+            cacheFile = argv[++i];
+        } else if (!strcmp(argv[i], "--network") && i + 1 < argc) {
+            if (!network.load(argv[++i])) exit(-1);
+        } else if (!strcmp(argv[i], "--mcts") && i + 1 < argc) {
+            playouts = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && file == NULL) {
+            file = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (limits.multipv < 0 || limits.depth < 1 || playouts < 0 ||
+        threads < 1) {
+        usage(argv[0]);
+    }
+
+    // Opened once the evaluator is known, which its keys depend on
+    if (cacheFile != NULL) {
+        if (!cache.open(cacheFile)) exit(-1);
+        shared = &cache;
+    }
+
+    MonteCarlo *mcts = NULL;
+    if (playouts > 0) {
+        mcts = new MonteCarlo();
+        mcts->threads = threads;
+        mcts->limit = playouts;
+    }
+
+    ifstream input;
+    if (file != NULL) {
+        input.open(file);
+        if (!input) {
+            cerr << "cannot open " << file << endl;
+            exit(-1);
+        }
+    }
+    istream &in = (file != NULL) ? input : cin;
+
+    string line, position, side;
+    int lineno = 0;
+    while (getline(in, line)) {
+        lineno++;
+        istringstream fields(line);
+        if (!(fields >> position) || position[0] == '#') continue;
+
+        if (!(fields >> side) || position.size() != 64 ||
+            (side != "b" && side != "w")) {
+            cerr << "line " << lineno << ": expected <64 squares> <b|w>"
+                 << endl;
+            continue;
+        }
+
+        if (mcts != NULL) {
+            monteCarlo(*mcts, position.c_str(), side == "b" ? BLACK : WHITE,
+                       limits.msTime, lineno);
+            continue;
+        }
+
+        AnalysisResult result;
+        analyzePosition(position.c_str(), side == "b" ? BLACK : WHITE,
+                        limits, result, shared);
+
+        cout << "position " << lineno << " depth " << result.depth
+             << " nodes " << result.nodes << " ms " << result.ms << endl;
+        if (result.moves.empty()) {
+            cout << "  pass" << endl;
+        }
+        for (unsigned int i = 0; i < result.moves.size(); i++) {
+            MoveAnalysis &move = result.moves[i];
+            cout << "  " << squareName(move.square) << " "
+                 << (move.score > 0 ? "+" : "") << move.score << " pv";
+            for (unsigned int j = 0; j < move.pv.size(); j++) {
+                cout << " " << squareName(move.pv[j]);
+            }
+            cout << endl;
+        }
+        cout.flush();
+    }
+
+    delete mcts;
+    return 0;
+}
@@ -0,0 +1,361 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <pthread.h>
+#include "analysis.h"
+#include "network.h"
+#include "probcut.h"
+#include "search.h"
+#include "threadpool.h"
+using namespace std;
+
+/*
+ * Batch annotation of finished games. Every input line is one game: an
+ * optional id, then its moves written as squares ("f5d6c3..."), passes left
+ * out. Each game is replayed through Board::doMove() and every move is
+ * scored against the best one by a --depth ply search, on --threads
+ * threads. One line is written per move, in input order:
+ *
+ *      <game> <ply> <b|w> <move> <score> <best> <best score> <loss> [?!|?|??]
+ *
+ * scores being for the side that moved, followed by "<game> end <black>
+ * <white>" with the final disc counts, or "<game> error <ply> <text>" if
+ * the transcript is broken.
+ *
+ * Positions the games share, openings most of all, are scored once: results
+ * go through a search cache (see cache.h), kept in --cache FILE or else in
+ * a private temporary file, which may be shared with other runs and tools.
+ * A position is scored the same whatever move was played from it, so the
+ * output does not depend on the order the games come in, --exact or not.
+ * Games are read as they are needed and at most ANNOTATE_WINDOW per thread
+ * are held at a time, so archives of any size stream through in bounded
+ * memory.
+ */
+
+#define ANNOTATE_WINDOW (8)         // games in flight per thread
+#define ANNOTATE_INACCURACY (4)     // losses from this much get "?!"
+#define ANNOTATE_MISTAKE (8)        // "?"
+#define ANNOTATE_BLUNDER (16)       // "??"
+#define ANNOTATE_SALT (0x9E3779B97F4A7C15UL)
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [--depth D] [--threads N] [--exact]"
+         << " [--cache FILE] [--network FILE]" << endl
+         << "       [--probcut FILE] [file]" << endl;
+    exit(-1);
+}
+
+/*
+ * What the workers share with the thread writing the results.
+ */
+struct Annotator {
+    SearchCache *cache;
+    int depth;
+    bool selective;
+
+    pthread_mutex_t lock;
+    pthread_cond_t finished;        // signalled when a game is done
+    map<long, string> results;      // finished games not yet written
+    unsigned long positions, nodes, hits;
+};
+
+/*
+ * The cache key of `board' scored to `depth' plies. Results are kept apart
+ * from those of Search, and by depth and selectivity, so that a game's
+ * scores never mix depths and do not depend on which games came before.
+ */
+static uint64_t key(Annotator &shared, Board &board, Side side, int depth) {
+    return SearchCache::hash(board, side) ^
+           (ANNOTATE_SALT * (2 * depth + shared.selective + 1));
+}
+
+static bool cached(Annotator &shared, Board &board, Side side, int depth,
+                   CacheEntry &entry) {
+    return shared.cache->probe(key(shared, board, side, depth), entry) &&
+           entry.bound == CACHE_EXACT && !entry.tree;
+}
+
+static void remember(Annotator &shared, Board &board, Side side, int depth,
+                     int score, int move) {
+    CacheEntry entry;
+    entry.score = score;
+    entry.depth = depth;
+    entry.bound = CACHE_EXACT;
+    entry.move = move;
+    entry.selective = shared.selective;
+    entry.tree = false;
+    shared.cache->store(key(shared, board, side, depth), entry);
+}
+
+/*
+ * Scores the move `played' by `side' from `board' and finds the best one,
+ * both for `side'. The best comes from searching every move in turn, each
+ * only as far as it beats the best so far, and the played move, unless it
+ * is the best, from a full-window search of the position after it. Neither
+ * depends on which move the game played, so both are cached, and a later
+ * game that gets here again needs no search at all. A played move that ties
+ * the best, or that selective search scores above it, is reported as the
+ * best.
+ *
+ * return: true if the cache answered.
+ */
+static bool scoreMove(Annotator &shared, Search &search, Board &board,
+                      Side side, int played, int &best, int &bestScore,
+                      int &playedScore) {
+    const int depth = shared.depth;
+    Side other = enemyof(side);
+    CacheEntry entry, after;
+    Move move(played % 8, played / 8);
+    uint64_t flips;
+    int list[64], n, v;
+    bool hit = true;
+
+    // Moves are made and taken back on `board' itself
+    search.setGuide(NULL, 0, 1);
+    if (!cached(shared, board, side, depth, entry) || entry.move < 0 ||
+        entry.move >= 64) {
+        hit = false;
+        entry.score = -SEARCH_INF;
+        n = board.moveList(side, list);
+        for (int i = 0; i < n; i++) {
+            Move m(list[i] % 8, list[i] / 8);
+            flips = board.doMove(&m, side);
+            v = -search.negamax(board, other, depth - 1, -SEARCH_INF,
+                                -entry.score, 1);
+            board.undoMove(list[i], flips);
+            if (v > entry.score) {
+                entry.move = list[i];
+                entry.score = v;
+            }
+        }
+        remember(shared, board, side, depth, entry.score, entry.move);
+    }
+    best = entry.move;
+    bestScore = playedScore = entry.score;
+    if (best == played) return hit;
+
+    flips = board.doMove(&move, side);
+    if (cached(shared, board, other, depth - 1, after)) {
+        playedScore = -after.score;
+    } else {
+        hit = false;
+        playedScore = -search.negamax(board, other, depth - 1, -SEARCH_INF,
+                                      SEARCH_INF, 1);
+        remember(shared, board, other, depth - 1, -playedScore,
+                 CACHE_NOMOVE);
+    }
+    board.undoMove(played, flips);
+
+    // The loss is never below 0
+    if (playedScore >= bestScore) {
+        best = played;
+        bestScore = playedScore;
+    }
+    return hit;
+}
+
+static const char *annotation(int loss) {
+    return (loss >= ANNOTATE_BLUNDER) ? " ??" :
+           (loss >= ANNOTATE_MISTAKE) ? " ?" :
+           (loss >= ANNOTATE_INACCURACY) ? " ?!" : "";
+}
+
+/*
+ * Replays and scores one game, returning its output lines.
+ */
+static string annotateGame(Annotator &shared, const string &id,
+                           const string &moves) {
+    Search search;
+    Board board;
+    Side side = BLACK;
+    ostringstream out;
+    unsigned long positions = 0, hits = 0;
+    int best, bestScore, playedScore;
+
+    search.selective = shared.selective;
+
+    for (unsigned int i = 0; i + 1 < moves.size(); i += 2) {
+        int x = tolower(moves[i]) - 'a', y = moves[i + 1] - '1';
+        int ply = i / 2 + 1, square = x + 8 * y;
+        Move move(x, y);
+
+        if (!board.hasMoves(side)) side = enemyof(side);
+        if (x < 0 || x > 7 || y < 0 || y > 7 ||
+            !board.checkMove(&move, side)) {
+            out << id << " error " << ply << " illegal move "
+                << moves.substr(i, 2) << "\n";
+            break;
+        }
+
+        if (scoreMove(shared, search, board, side, square, best, bestScore,
+                      playedScore)) {
+            hits++;
+        }
+        positions++;
+        out << id << " " << ply << " " << (side == BLACK ? "b " : "w ")
+            << squareName(square) << " " << playedScore << " "
+            << squareName(best) << " " << bestScore << " "
+            << bestScore - playedScore
+            << annotation(bestScore - playedScore) << "\n";
+
+        board.doMove(&move, side);
+        side = enemyof(side);
+    }
+    if (moves.size() % 2) {
+        out << id << " error " << moves.size() / 2 + 1
+            << " trailing character\n";
+    }
+    out << id << " end " << board.countBlack() << " " << board.countWhite()
+        << "\n";
+
+    pthread_mutex_lock(&shared.lock);
+    shared.positions += positions;
+    shared.nodes += search.nodes;
+    shared.hits += hits;
+    pthread_mutex_unlock(&shared.lock);
+    return out.str();
+}
+
+class AnnotateTask : public Task {
+public:
+    AnnotateTask(Annotator *shared, long index, const string &id,
+                 const string &moves)
+        : shared(shared), index(index), id(id), moves(moves) {}
+
+    void run(int) {
+        string result = annotateGame(*this->shared, this->id, this->moves);
+        pthread_mutex_lock(&this->shared->lock);
+        this->shared->results[this->index] = result;
+        pthread_cond_signal(&this->shared->finished);
+        pthread_mutex_unlock(&this->shared->lock);
+    }
+
+private:
+    Annotator *shared;
+    long index;
+    string id, moves;
+};
+
+/*
+ * Writes the finished games that are next in input order. Called with the
+ * lock held.
+ */
+static void flush(Annotator &shared, long &written) {
+    map<long, string>::iterator it;
+    while ((it = shared.results.find(written)) != shared.results.end()) {
+        cout << it->second;
+        shared.results.erase(it);
+        written++;
+    }
+    cout.flush();
+}
+
+int main(int argc, char *argv[]) {
+    Annotator shared;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *file = NULL, *cacheFile = NULL;
+    SearchCache cache;
+
+    shared.depth = 6;
+    shared.selective = true;
+    shared.positions = shared.nodes = shared.hits = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            shared.depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--exact")) {
+            shared.selective = false;
+        } else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+            cacheFile = argv[++i];
+        } else if (!strcmp(argv[i], "--network") && i + 1 < argc) {
+            if (!network.load(argv[++i])) exit(-1);
+        } else if (!strcmp(argv[i], "--probcut") && i + 1 < argc) {
+            if (!probCut.load(argv[++i])) exit(-1);
+        } else if (argv[i][0] != '-' && file == NULL) {
+            file = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (shared.depth < 1 || shared.depth > PC_MAXDEPTH || threads < 1) {
+        usage(argv[0]);
+    }
+
+    // Without --cache, a file of our own that goes away with the process
+    if (cacheFile == NULL) {
+        char name[] = "/tmp/annotate-XXXXXX";
+        int fd = mkstemp(name);
+        if (fd < 0) {
+            cerr << "cannot create a temporary cache" << endl;
+            exit(-1);
+        }
+        close(fd);
+        unlink(name);
+        if (!cache.open(name)) exit(-1);
+        unlink(name);
+    } else if (!cache.open(cacheFile)) {
+        exit(-1);
+    }
+    shared.cache = &cache;
+
+    ifstream input;
+    if (file != NULL) {
+        input.open(file);
+        if (!input) {
+            cerr << "cannot open " << file << endl;
+            exit(-1);
+        }
+    }
+    istream &in = (file != NULL) ? input : cin;
+
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.finished, NULL);
+    int64_t started = nowms();
+    long submitted = 0, written = 0, lineno = 0;
+    {
+        ThreadPool pool(threads);
+        string line, first, second;
+
+        while (getline(in, line)) {
+            lineno++;
+            istringstream fields(line);
+            if (!(fields >> first) || first[0] == '#') continue;
+            if (!(fields >> second)) {
+                ostringstream number;
+                number << lineno;
+                second = first;
+                first = number.str();
+            }
+
+            pthread_mutex_lock(&shared.lock);
+            while (submitted - written >= (long)ANNOTATE_WINDOW * threads) {
+                flush(shared, written);
+                if (submitted - written >= (long)ANNOTATE_WINDOW * threads) {
+                    pthread_cond_wait(&shared.finished, &shared.lock);
+                }
+            }
+            pthread_mutex_unlock(&shared.lock);
+
+            pool.submit(new AnnotateTask(&shared, submitted++, first,
+                                         second));
+        }
+        pool.wait();
+    }
+    flush(shared, written);
+
+    int ms = (int)(nowms() - started);
+    cerr << "annotate: " << written << " games, " << shared.positions
+         << " positions (" << shared.hits << " from the cache), "
+         << shared.nodes << " nodes, " << ms << " ms" << endl;
+
+    pthread_cond_destroy(&shared.finished);
+    pthread_mutex_destroy(&shared.lock);
+    return 0;
+}
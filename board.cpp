@@ -1,17 +1,13 @@
 #include "board.h"
+#include "config.h"
 #include "stdlib.h"
 
 
 /*
- * Make a standard 8x8 othello board and initialize it to the standard setup.
+ * Make a standard 8x8 othello board and initialize it to the standard setup
+ * (done by GridBoard).
  */
 Board::Board() {
-    taken.set(3 + 8 * 3);
-    taken.set(3 + 8 * 4);
-    taken.set(4 + 8 * 3);
-    taken.set(4 + 8 * 4);
-    black.set(4 + 8 * 3);
-    black.set(3 + 8 * 4);
 }
 
 /*
@@ -20,31 +16,8 @@ Board::Board() {
 Board::~Board() {
 }
 
-/*
- * Returns a copy of this board.
- */
-Board *Board::copy() {
-    Board *newBoard = new Board();
-    newBoard->black = black;
-    newBoard->taken = taken;
-    return newBoard;
-}
-
 bool Board::occupied(int x, int y) {
-    return taken[x + 8*y];
-}
-
-bool Board::get(Side side, int x, int y) {
-    return occupied(x, y) && (black[x + 8*y] == (side == BLACK));
-}
-
-void Board::set(Side side, int x, int y) {
-    taken.set(x + 8*y);
-    black.set(x + 8*y, side == BLACK);
-}
-
-bool Board::onBoard(int x, int y) {
-    return(0 <= x && x < 8 && 0 <= y && y < 8);
+    return ((bits[WHITE] | bits[BLACK]) >> (x + 8*y)) & 1;
 }
 
  
@@ -60,13 +33,29 @@ bool Board::isDone() {
  * Returns true if there are legal moves for the given side.
  */
 bool Board::hasMoves(Side side) {
+    return moves(side) != 0;
+}
+
+/*
+ * Legal moves for the given side as a bitboard.
+ */
+uint64_t Board::moves(Side side) {
+    return (side == BLACK) ? movesFor<BLACK>() : movesFor<WHITE>();
+}
+
+/*
+ * Fills `list' with the legal moves for the given side, as square indices
+ * x + 8*y, and returns how many there are. `list' must hold 64 entries.
+ */
+int Board::moveList(Side side, int list[]) {
+    uint64_t legal = moves(side);
+    int n = 0;
     for (int i = 0; i < 8; i++) {
         for (int j = 0; j < 8; j++) {
-            Move move(i, j);
-            if (checkMove(&move, side)) return true;
+            if ((legal >> (i + 8*j)) & 1) list[n++] = i + 8*j;
         }
     }
-    return false;
+    return n;
 }
 
 /*
@@ -76,107 +65,79 @@ bool Board::checkMove(Move *m, Side side) {
     // Passing is only legal if you have no moves.
     if (m == NULL) return !hasMoves(side);
 
-    int X = m->getX();
-    int Y = m->getY();
-
     // Make sure the square hasn't already been taken.
-    if (occupied(X, Y)) return false;
-
-    Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
-
-            // Is there a capture in that direction?
-            int x = X + dx;
-            int y = Y + dy;
-            if (onBoard(x, y) && get(other, x, y )) {
-                do {
-                    x += dx;
-                    y += dy;
-                } while (onBoard(x, y) && get(other, x, y));
+    if (occupied(m->getX(), m->getY())) return false;
 
-                if (onBoard(x, y) && get(side, x, y)) return true;
-            }
-        }
-    }
-    return false;
+    int square = m->getX() + 8 * m->getY();
+    return ((side == BLACK) ? flipsFor<BLACK>(square)
+                            : flipsFor<WHITE>(square)) != 0;
 }
 
 /*
- * Modifies the board to reflect the specified move.
+ * Modifies the board to reflect the specified move, and returns the discs it
+ * flipped, which undoMove() needs to take it back. A pass or an illegal move
+ * changes nothing and returns 0.
  */
-void Board::doMove(Move *m, Side side) {
+uint64_t Board::doMove(Move *m, Side side) {
     // A NULL move means pass.
-    if (m == NULL) return;
+    if (m == NULL) return 0;
 
     // Ignore if move is invalid.
-    if (!checkMove(m, side)) return;
-
-    int X = m->getX();
-    int Y = m->getY();
-    Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
-
-            int x = X;
-            int y = Y;
-            do {
-                x += dx;
-                y += dy;
-            } while (onBoard(x, y) && get(other, x, y));
-
-            if (onBoard(x, y) && get(side, x, y)) {
-                x = X;
-                y = Y;
-                x += dx;
-                y += dy;
-                while (onBoard(x, y) && get(other, x, y)) {
-                    set(side, x, y);
-                    x += dx;
-                    y += dy;
-                }
-            }
-        }
+    if (occupied(m->getX(), m->getY())) return 0;
+
+    int square = m->getX() + 8 * m->getY();
+    uint64_t flips;
+    if (side == BLACK) {
+        flips = flipsFor<BLACK>(square);
+        if (flips) play<BLACK>(square, flips);
+    } else {
+        flips = flipsFor<WHITE>(square);
+        if (flips) play<WHITE>(square, flips);
     }
-    set(side, X, Y);
+    return flips;
 }
 
 /*
- * Current count of given side's stones.
+ * Takes back the move on `square' that flipped `flips', as returned by
+ * doMove(). The mover is whoever owns the square now.
  */
-int Board::count(Side side) {
-    return (side == BLACK) ? countBlack() : countWhite();
+void Board::undoMove(int square, uint64_t flips) {
+    if ((bits[BLACK] >> square) & 1) {
+        undo<BLACK>(square, flips);
+    } else {
+        undo<WHITE>(square, flips);
+    }
 }
 
 /*
  * Current count of black stones.
  */
 int Board::countBlack() {
-    return black.count();
+    return __builtin_popcountl(bits[BLACK]);
 }
 
 /*
  * Current count of white stones.
  */
 int Board::countWhite() {
-    return taken.count() - black.count();
+    return __builtin_popcountl(bits[WHITE]);
 }
 
+#define CORNERS (G::corners())
+#define ADJCORNERS (0x42c300000000c342UL)   // the squares next to corners
+#define EDGES (G::edges() & ~CORNERS)
+
 /*
  * Sets the board state given an 8x8 char array where 'w' indicates a white
  * piece and 'b' indicates a black piece. Mainly for testing purposes.
  */
 void Board::setBoard(char data[]) {
-    taken.reset();
-    black.reset();
+    bits[WHITE] = bits[BLACK] = 0;
     for (int i = 0; i < 64; i++) {
         if (data[i] == 'b') {
-            taken.set(i);
-            black.set(i);
+            bits[BLACK] |= (uint64_t)1 << i;
         } if (data[i] == 'w') {
-            taken.set(i);
+            bits[WHITE] |= (uint64_t)1 << i;
         }
     }
 }
@@ -185,103 +146,38 @@ void Board::setBoard(char data[]) {
 
 /**
  * heuristic: A very basic heuristic for weighting different boards. Polarized
- * such that positive is better for black.
+ * such that positive is better for black. Each term is counted over a mask
+ * of the squares it rewards.
  */
 int16_t Board::heuristic()
 {
-    int base = this->countBlack() - this->countWhite();
-    int sign = (base != 0 ? abs(base)/base : 0);
+    uint64_t b = this->bits[BLACK], w = this->bits[WHITE];
+    int base = __builtin_popcountl(b) - __builtin_popcountl(w);
 
-    int ret = (this->hasMoves(WHITE) || this->hasMoves(BLACK)) ? base : base +
-        sign*WINSC;
-
-    if(this->countBlack() + this->countWhite() > NEAREND){   // if near end, just count stones
-        ret = this->countBlack() - this->countWhite();
+    // if near end, just count stones
+    if(__builtin_popcountl(b | w) > config.nearEnd){
+        return((int16_t)base);
     }
-    else{
-        //check corners
-        ret += this->get(BLACK, 0, 0) ? CORNSCR : 0;
-        ret -= this->get(WHITE, 0, 0) ? CORNSCR : 0;
-
-        ret += this->get(BLACK, 7, 0) ? CORNSCR : 0;
-        ret -= this->get(WHITE, 7, 0) ? CORNSCR : 0;
-        
-        ret += this->get(BLACK, 0, 7) ? CORNSCR : 0;
-        ret -= this->get(WHITE, 0, 7) ? CORNSCR : 0;
-        
-        ret += this->get(BLACK, 7, 7) ? CORNSCR : 0;
-        ret -= this->get(WHITE, 7, 7) ? CORNSCR : 0;
-
 
-        // Penalize spaces near corners:
-
-        ret -= this->get(BLACK, 1, 0) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 1, 0) ? ADJCORNSCR : 0;
-
-        ret -= this->get(BLACK, 0, 1) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 0, 1) ? ADJCORNSCR : 0;
-        
-        ret -= this->get(BLACK, 1, 1) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 1, 1) ? ADJCORNSCR : 0;
-
-        ////////////////////////////////////////////
-        
-        ret -= this->get(BLACK, 0, 6) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 0, 6) ? ADJCORNSCR : 0;
-
-        ret -= this->get(BLACK, 1, 7) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 1, 7) ? ADJCORNSCR : 0;
-        
-        ret -= this->get(BLACK, 1, 6) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 1, 6) ? ADJCORNSCR : 0;
-
-        ////////////////////////////////////////////
-        
-        ret -= this->get(BLACK, 6, 0) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 6, 0) ? ADJCORNSCR : 0;
+    int sign = (base != 0 ? abs(base)/base : 0);
+    int ret = (this->hasMoves(WHITE) || this->hasMoves(BLACK)) ? base : base +
+        sign*config.win;
 
-        ret -= this->get(BLACK, 7, 1) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 7, 1) ? ADJCORNSCR : 0;
-        
-        ret -= this->get(BLACK, 6, 1) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 6, 1) ? ADJCORNSCR : 0;
+    //check corners
+    ret += config.corner * (__builtin_popcountl(b & CORNERS) -
+                            __builtin_popcountl(w & CORNERS));
 
-        ////////////////////////////////////////////
-        
-        ret -= this->get(BLACK, 6, 7) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 6, 7) ? ADJCORNSCR : 0;
+    // Penalize spaces near corners:
+    ret -= config.adjacentCorner * (__builtin_popcountl(b & ADJCORNERS) -
+                                    __builtin_popcountl(w & ADJCORNERS));
 
-        ret -= this->get(BLACK, 7, 6) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 7, 6) ? ADJCORNSCR : 0;
-        
-        ret -= this->get(BLACK, 6, 6) ? ADJCORNSCR : 0;
-        ret += this->get(WHITE, 6, 6) ? ADJCORNSCR : 0;
+    // Check edge spaces
+    ret += config.edge * (__builtin_popcountl(b & EDGES) -
+                          __builtin_popcountl(w & EDGES));
 
-        // Check edge spaces
+    // Reward discs that can never be lost
+    ret += config.stable * __builtin_popcountl(this->stable(BLACK));
+    ret -= config.stable * __builtin_popcountl(this->stable(WHITE));
 
-        for(int i = 1; i < 7; i++){
-            ret += this->get(BLACK, i, 0) ? EDGESCR : 0;
-            ret -= this->get(WHITE, i, 0) ? EDGESCR : 0;
-        }
-        for(int i = 1; i < 7; i++){
-            ret += this->get(BLACK, 0, i) ? EDGESCR : 0;
-            ret -= this->get(WHITE, 0, i) ? EDGESCR : 0;
-        }
-        for(int i = 1; i < 7; i++){
-            ret += this->get(BLACK, i, 7) ? EDGESCR : 0;
-            ret -= this->get(WHITE, i, 7) ? EDGESCR : 0;
-        }
-        for(int i = 1; i < 7; i++){
-            ret += this->get(BLACK, 7, i) ? EDGESCR : 0;
-            ret -= this->get(WHITE, 7, i) ? EDGESCR : 0;
-        }
-    }
     return((int16_t)ret);
 }
-
-
-
-
-
-
-
@@ -1,44 +1,48 @@
 #ifndef __BOARD_H__
 #define __BOARD_H__
 
-#include <bitset>
 #include "common.h"
+#include "geometry.h"
 
+// Defaults of the weights and the endgame threshold, which are read from
+// `config' at run time (see config.h)
 #define WINSC (100)
 #define CORNSCR (5)
 #define ADJCORNSCR (0)
 #define EDGESCR (3)
+#define STABLESCR (2)   // per disc that can never be flipped
 #define NEAREND (48)    // how close near end to switch to a simpler heuristic
 
 using namespace std;
 
-class Board {
+/*
+ * The engine's board: the 8x8 GridBoard (see geometry.h), whose bitboards
+ * and side-specialized kernels it inherits, with the heuristic on top.
+ */
+class Board : public GridBoard<8> {
    
 private:
-    bitset<64> black;
-    bitset<64> taken;    
-       
     bool occupied(int x, int y);
-    bool get(Side side, int x, int y);
-    void set(Side side, int x, int y);
-    bool onBoard(int x, int y);
       
 public:
     Board();
     ~Board();
-    Board *copy();
         
     bool isDone();
     bool hasMoves(Side side);
+    int moveList(Side side, int list[]);
     bool checkMove(Move *m, Side side);
-    void doMove(Move *m, Side side);
-    int count(Side side);
+    uint64_t doMove(Move *m, Side side);
+    void undoMove(int square, uint64_t flips);
     int countBlack();
     int countWhite();
 
+    uint64_t moves(Side side);
+
     int16_t heuristic();
 
     void setBoard(char data[]);
 };
 
+
 #endif
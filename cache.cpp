@@ -0,0 +1,287 @@
+#include "cache.h"
+#include "config.h"
+#include "search.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "OTHCACHE"
+#define CACHE_VERSION (2)
+#define CACHE_BUCKET (4)    // slots a position may occupy
+
+/*
+ * Entry packing: bits 0-15 score, 16-23 depth, 24-25 bound, 26 selective,
+ * 27-33 move (64 for a pass), 34 tree.
+ */
+#define DEPTH(data) ((int)((data) >> 16 & 0xFF))
+#define SELECTIVE(data) ((bool)((data) >> 26 & 1))
+#define TREE(data) ((bool)((data) >> 34 & 1))
+
+static uint64_t pack(const CacheEntry &entry)
+{
+    int move = (entry.move == PASS) ? 64 : entry.move;
+    return (uint64_t)(uint16_t)entry.score |
+           (uint64_t)entry.depth << 16 |
+           (uint64_t)(entry.bound & 3) << 24 |
+           (uint64_t)(entry.selective ? 1 : 0) << 26 |
+           (uint64_t)(move & 127) << 27 |
+           (uint64_t)(entry.tree ? 1 : 0) << 34;
+}
+
+static CacheEntry unpack(uint64_t data)
+{
+    CacheEntry entry;
+    entry.score = (int16_t)(data & 0xFFFF);
+    entry.depth = DEPTH(data);
+    entry.bound = (data >> 24) & 3;
+    entry.selective = SELECTIVE(data);
+    entry.move = (data >> 27) & 127;
+    entry.tree = TREE(data);
+    if(entry.move == 64)
+    {
+        entry.move = PASS;
+    }
+    return entry;
+}
+
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdUL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53UL;
+    x ^= x >> 33;
+    return x;
+}
+
+
+SearchCache::SearchCache()
+{
+    this->map = NULL;
+    this->mapsize = 0;
+    this->slots = NULL;
+    this->nslots = 0;
+    this->salt = 0;
+}
+
+SearchCache::~SearchCache()
+{
+    this->close();
+}
+
+/**
+ * hash: the key of a position. It only depends on the discs and the side to
+ * move, so every process agrees on it.
+ */
+uint64_t SearchCache::hash(Board &board, Side side)
+{
+    return mix(board.discs(BLACK) ^ mix(board.discs(WHITE) + side + 1));
+}
+
+/**
+ * open: maps `file', creating it with room for about `bytes' of entries if
+ * it does not exist yet. An existing file keeps its own size.
+ *
+ * return: false if the file is unusable; the cache then stays closed and
+ * every probe misses.
+ */
+bool SearchCache::open(const char *file, size_t bytes)
+{
+    struct stat st;
+    uint64_t want = 1;
+    int fd;
+
+    this->close();
+
+    while(want * 2 * sizeof(Slot) <= bytes)
+    {
+        want *= 2;
+    }
+    if(want < CACHE_BUCKET)
+    {
+        want = CACHE_BUCKET;
+    }
+
+    fd = ::open(file, O_RDWR);
+    if(fd < 0)
+    {
+        if(!this->create(file, want))
+        {
+            return false;
+        }
+        fd = ::open(file, O_RDWR);
+    }
+    if(fd < 0 || fstat(fd, &st) || (size_t)st.st_size < sizeof(Header))
+    {
+        ERROR(__FILE__, __LINE__, "cannot open cache %s", file);
+        if(fd >= 0) ::close(fd);
+        return false;
+    }
+
+    this->mapsize = st.st_size;
+    this->map = mmap(NULL, this->mapsize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+    ::close(fd);
+    if(this->map == MAP_FAILED)
+    {
+        ERROR(__FILE__, __LINE__, "cannot map cache %s", file);
+        this->map = NULL;
+        return false;
+    }
+
+    Header *header = (Header *)this->map;
+    if(memcmp(header->magic, CACHE_MAGIC, 8) ||
+       header->version != CACHE_VERSION ||
+       header->slotsize != sizeof(Slot) ||
+       header->slots < CACHE_BUCKET ||
+       (header->slots & (header->slots - 1)) ||
+       sizeof(Header) + header->slots * sizeof(Slot) > this->mapsize)
+    {
+        ERROR(__FILE__, __LINE__, "%s is not a search cache", file);
+        this->close();
+        return false;
+    }
+
+    this->nslots = header->slots;
+    this->slots = (Slot *)((char *)this->map + sizeof(Header));
+    this->salt = config.fingerprint();
+    return true;
+}
+
+/**
+ * create: writes an empty cache under a temporary name and links it to
+ * `file'. If another process got there first its file is kept.
+ */
+bool SearchCache::create(const char *file, uint64_t nslots)
+{
+    char tmp[ERR_BUFFER_SIZE];
+    Header header;
+    int fd;
+
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", file, (int)getpid());
+    fd = ::open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        ERROR(__FILE__, __LINE__, "cannot create %s", tmp);
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    header.version = CACHE_VERSION;
+    header.slotsize = sizeof(Slot);
+    header.slots = nslots;
+
+    // Zero-filled slots read as empty, so extending the file is enough
+    bool ok = ftruncate(fd, sizeof(Header) + nslots * sizeof(Slot)) == 0 &&
+              write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+              fsync(fd) == 0;
+    ::close(fd);
+
+    if(ok && link(tmp, file) && errno != EEXIST)
+    {
+        ok = false;
+    }
+    unlink(tmp);
+
+    if(!ok)
+    {
+        ERROR(__FILE__, __LINE__, "cannot create cache %s", file);
+    }
+    return ok;
+}
+
+void SearchCache::close()
+{
+    if(this->map != NULL)
+    {
+        this->sync();
+        munmap(this->map, this->mapsize);
+    }
+    this->map = NULL;
+    this->slots = NULL;
+    this->nslots = 0;
+}
+
+/**
+ * sync: asks the kernel to start writing the cache back to disk, which
+ * close() does in any case. Writing back the whole map is not cheap, so
+ * this is not for every move.
+ */
+void SearchCache::sync()
+{
+    if(this->map != NULL)
+    {
+        msync(this->map, this->mapsize, MS_ASYNC);
+    }
+}
+
+/**
+ * probe: looks `key' up in its bucket.
+ *
+ * return: true with `entry' filled in on a hit.
+ */
+bool SearchCache::probe(uint64_t key, CacheEntry &entry)
+{
+    if(this->slots == NULL)
+    {
+        return false;
+    }
+
+    key ^= this->salt;
+    Slot *bucket = &this->slots[key & (this->nslots - CACHE_BUCKET)];
+    for(int i = 0; i < CACHE_BUCKET; i++)
+    {
+        uint64_t data = bucket[i].data;
+        uint64_t check = bucket[i].check;
+        if((check ^ data) == key && DEPTH(data))
+        {
+            entry = unpack(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * store: writes an entry over the slot already holding `key', or else over
+ * the shallowest slot of its bucket. A deeper result for the same position
+ * is kept unless it was pruned by ProbCut or came from the Player's tree,
+ * and the new one did not.
+ */
+void SearchCache::store(uint64_t key, const CacheEntry &entry)
+{
+    if(this->slots == NULL || entry.depth < 1)
+    {
+        return;
+    }
+
+    key ^= this->salt;
+    Slot *bucket = &this->slots[key & (this->nslots - CACHE_BUCKET)];
+    Slot *victim = &bucket[0];
+    for(int i = 0; i < CACHE_BUCKET; i++)
+    {
+        uint64_t data = bucket[i].data;
+        if((bucket[i].check ^ data) == key)
+        {
+            if(DEPTH(data) > entry.depth &&
+               (entry.selective || !SELECTIVE(data)) &&
+               (entry.tree || !TREE(data)))
+            {
+                return;
+            }
+            victim = &bucket[i];
+            break;
+        }
+        if(DEPTH(data) < DEPTH(victim->data))
+        {
+            victim = &bucket[i];
+        }
+    }
+
+    uint64_t data = pack(entry);
+    victim->data = data;
+    victim->check = key ^ data;
+}
@@ -0,0 +1,92 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "common.h"
+#include "board.h"
+
+#define CACHE_EXACT (0)
+#define CACHE_LOWER (1)     // the score is at least `score'
+#define CACHE_UPPER (2)     // the score is at most `score'
+#define CACHE_NOMOVE (127)
+#define CACHE_MINDEPTH (3)  // shallower results are not worth a slot
+#define CACHE_SIZE (64000000)
+
+using namespace std;
+
+/**
+ * CacheEntry: what is remembered about a position: the result of a search
+ * to `depth' plies, the best move found (a square index x + 8*y, PASS or
+ * CACHE_NOMOVE), whether ProbCut was allowed to prune it and whether it
+ * came from the Player's tree (see player.h) rather than from Search. The
+ * tree's score is a plain minimax of the heuristic at its bottom level,
+ * which Search must not take for a negamax result of its own.
+ */
+struct CacheEntry
+{
+    int16_t score;
+    uint8_t depth;
+    uint8_t bound;
+    int8_t move;
+    bool selective;
+    bool tree;
+};
+
+/**
+ * SearchCache: a transposition table kept in a memory-mapped file, so that
+ * results survive the process and are shared by every process (and thread)
+ * mapping the same file.
+ *
+ * Each slot is two 64-bit words, the packed entry and the entry XORed with
+ * the position's key. A slot whose words do not agree, because two writers
+ * raced or a writer died half way, simply reads as a miss, so no locking is
+ * needed and a crash can never leave a wrong entry behind. A new file is
+ * fully set up under a temporary name and then linked into place.
+ *
+ * Keys are salted with the fingerprint of the evaluation in use when the
+ * cache is opened (see Config::fingerprint()), so processes with other
+ * heuristic weights or another network share the file without seeing
+ * each other's results. Open the cache once the evaluator is set up.
+ */
+class SearchCache
+{
+public:
+    SearchCache();
+    ~SearchCache();
+
+    bool open(const char *file, size_t bytes = CACHE_SIZE);
+    void close();
+    void sync();
+
+    bool probe(uint64_t key, CacheEntry &entry);
+    void store(uint64_t key, const CacheEntry &entry);
+
+    static uint64_t hash(Board &board, Side side);
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotsize;
+        uint64_t slots;
+    };
+
+    struct Slot
+    {
+        volatile uint64_t check;    // key ^ data
+        volatile uint64_t data;
+    };
+
+    void *map;
+    size_t mapsize;
+    Slot *slots;
+    uint64_t nslots;        // a power of two
+    uint64_t salt;          // mixed into every key
+
+    bool create(const char *file, uint64_t nslots);
+
+    SearchCache(const SearchCache &);
+    SearchCache &operator=(const SearchCache &);
+};
+
+#endif
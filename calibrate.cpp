@@ -0,0 +1,155 @@
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "board.h"
+#include "search.h"
+#include "probcut.h"
+#include "network.h"
+using namespace std;
+
+/*
+ * Fits the Multi-ProbCut parameters (see probcut.h). Sample positions come
+ * from random games; each is searched exactly to every depth up to --depth,
+ * and for each stage and pair of depths the deep scores are regressed on the
+ * shallow ones. The fitted parameters are written to --out in the format of
+ * ProbCut::load(). With --network the searches evaluate with those weights
+ * (see network.h), whose scores need parameters of their own.
+ */
+
+#define MINSAMPLES (20)     // fewer than this and a stage uses all stages
+
+struct Fit {
+    double n, x, y, xx, xy, yy;
+};
+
+// fits[PC_STAGES] pools the samples of every stage
+static Fit fits[PC_STAGES + 1][PC_MAXDEPTH + 1][PC_TRIES];
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [--positions N] [--depth D] [--seed S]"
+         << " [--out FILE]" << endl
+         << "       [--network FILE]" << endl;
+    exit(-1);
+}
+
+/*
+ * Plays `plies' random moves from the start position. Returns false if the
+ * game ends first.
+ */
+static bool randomPosition(Board &board, Side &side, int plies) {
+    int list[64], n;
+    Move move(0, 0);
+
+    board = Board();
+    side = BLACK;
+    for (int i = 0; i < plies; i++) {
+        n = board.moveList(side, list);
+        if (n) {
+            int square = list[rand() % n];
+            move.x = square % 8;
+            move.y = square / 8;
+            board.doMove(&move, side);
+        } else if (!board.hasMoves(enemyof(side))) {
+            return false;
+        }
+        side = enemyof(side);
+    }
+    return board.hasMoves(side);
+}
+
+int main(int argc, char *argv[]) {
+    int positions = 200, maxdepth = 10, seed = 1;
+    const char *out = "probcut.txt";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--positions") && i + 1 < argc) {
+            positions = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            maxdepth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out = argv[++i];
+        } else if (!strcmp(argv[i], "--network") && i + 1 < argc) {
+            if (!network.load(argv[++i])) exit(-1);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (positions < 1 || maxdepth < PC_MINDEPTH || maxdepth > PC_MAXDEPTH) {
+        usage(argv[0]);
+    }
+
+    srand(seed);
+    memset(fits, 0, sizeof(fits));
+
+    Search search;
+    search.selective = false;
+
+    int done = 0;
+    while (done < positions) {
+        Board board;
+        Side side;
+        if (!randomPosition(board, side, rand() % 56)) continue;
+
+        int stage = ProbCut::stage(board);
+        int scores[PC_MAXDEPTH + 1];
+        for (int depth = 1; depth <= maxdepth; depth++) {
+            scores[depth] = search.negamax(board, side, depth, -SEARCH_INF,
+                                           SEARCH_INF, 0);
+        }
+
+        for (int deep = PC_MINDEPTH; deep <= maxdepth; deep++) {
+            for (int k = 0; k < PC_TRIES; k++) {
+                int shallow = ProbCut::shallowDepth(deep, k);
+                if (!shallow) continue;
+
+                double x = scores[shallow], y = scores[deep];
+                for (int s = 0; s < 2; s++) {
+                    Fit &fit = fits[s ? PC_STAGES : stage][deep][k];
+                    fit.n++;
+                    fit.x += x;
+                    fit.y += y;
+                    fit.xx += x * x;
+                    fit.xy += x * y;
+                    fit.yy += y * y;
+                }
+            }
+        }
+
+        done++;
+        if (done % 10 == 0) {
+            cerr << done << " positions, " << search.nodes << " nodes" << endl;
+        }
+    }
+
+    // Least squares y = a x + b, and the deviation of the residuals
+    for (int stage = 0; stage < PC_STAGES; stage++) {
+        for (int deep = PC_MINDEPTH; deep <= maxdepth; deep++) {
+            for (int k = 0; k < PC_TRIES; k++) {
+                Fit *fit = &fits[stage][deep][k];
+                if (fit->n < MINSAMPLES) fit = &fits[PC_STAGES][deep][k];
+
+                double n = fit->n, x = fit->x, y = fit->y;
+                double xx = fit->xx, xy = fit->xy, yy = fit->yy;
+                double det = n * xx - x * x;
+                if (n < MINSAMPLES || det <= 0) continue;
+
+                double a = (n * xy - x * y) / det;
+                double b = (y - a * x) / n;
+                double sse = yy - 2 * a * xy - 2 * b * y +
+                             a * a * xx + 2 * a * b * x + n * b * b;
+
+                ProbCutPair &pair = probCut.pairs[stage][deep][k];
+                pair.a = a;
+                pair.b = b;
+                pair.sigma = sqrt(sse > 0 ? sse / n : 0);
+            }
+        }
+    }
+
+    if (!probCut.save(out)) return -1;
+    cerr << "wrote " << out << endl;
+    return 0;
+}
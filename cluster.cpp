@@ -0,0 +1,383 @@
+#include "cluster.h"
+#include "config.h"
+#include "network.h"
+#include "player.h"
+#include "search.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/*
+ * sendAll: writes all of `buf' to the socket `fd'. A worker that has died
+ * makes this fail rather than raise SIGPIPE.
+ */
+static bool sendAll(int fd, const char *buf, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+
+/**
+ * Cluster: forks `workers' worker processes. Each allocates its own Brain
+ * of `bytes' bytes with `flags' (see Brain) once it is running, so the
+ * memory of the whole cluster is never mapped in one process.
+ */
+Cluster::Cluster(int workers, size_t bytes, int flags)
+{
+    int fds[2];
+    pid_t pid;
+
+    this->score = 0;
+    this->depth = 0;
+    this->nodes = 0;
+
+    for(int i = 0; i < workers; i++)
+    {
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        {
+            ERROR(__FILE__, __LINE__, "cannot make a socket pair: %s",
+                  strerror(errno));
+            exit(-1);
+        }
+
+        // Nothing buffered may be written twice
+        cout.flush();
+        cerr.flush();
+        pid = fork();
+        if(pid < 0)
+        {
+            ERROR(__FILE__, __LINE__, "cannot fork a worker: %s",
+                  strerror(errno));
+            exit(-1);
+        }
+        if(pid == 0)
+        {
+            close(fds[0]);
+            for(unsigned int j = 0; j < this->workers.size(); j++)
+            {
+                fclose(this->workers[j].in);
+            }
+            serve(fds[1], bytes, flags);
+            _exit(0);
+        }
+
+        close(fds[1]);
+        Worker worker;
+        worker.pid = pid;
+        worker.fd = fds[0];
+        worker.in = fdopen(fds[0], "r");
+        worker.job = -1;
+        this->workers.push_back(worker);
+    }
+}
+
+/**
+ * ~Cluster: closes the sockets, on which the workers exit, and waits for
+ * them.
+ */
+Cluster::~Cluster()
+{
+    for(unsigned int i = 0; i < this->workers.size(); i++)
+    {
+        if(this->workers[i].fd >= 0)
+        {
+            fclose(this->workers[i].in);
+        }
+        waitpid(this->workers[i].pid, NULL, 0);
+    }
+}
+
+/**
+ * search: the move for `side' on `board', searched a round deeper at a
+ * time until config.depth, a tree too big for a worker, or `deadline' (-1
+ * for none). The next round is not started if, growing as much as the
+ * last one did, it would not be done in time.
+ *
+ * return: the move as a square index x + 8*y, or -1 to pass.
+ */
+int Cluster::search(Board &board, Side side, int64_t deadline)
+{
+    const Side other = enemyof(side);
+    int sign = (side == BLACK) ? 1 : -1, list[64], n, best;
+    int64_t started, last = 0, before = 0;
+
+    this->jobs.clear();
+    this->nodes = 0;
+    this->depth = 1;
+
+    // Until a round is complete each move has its static score
+    n = board.moveList(side, list);
+    for(int i = 0; i < n; i++)
+    {
+        Job job;
+        Move move(list[i] % 8, list[i] / 8);
+
+        job.square = list[i];
+        job.board = board;
+        job.board.doMove(&move, side);
+        job.over = false;
+        job.nodes = 0;
+        if(job.board.hasMoves(other))
+        {
+            job.toMove = other;
+            job.sign = -1;
+        }
+        else if(job.board.hasMoves(side))
+        {
+            job.toMove = side;
+            job.sign = 1;
+        }
+        else
+        {
+            job.over = true;
+        }
+        job.score = sign * ((network.loaded && job.board.countBlack() +
+                             job.board.countWhite() <= config.nearEnd)
+                            ? network.evaluate(job.board)
+                            : job.board.heuristic());
+        this->jobs.push_back(job);
+    }
+    if(!n)
+    {
+        return -1;
+    }
+
+    for(int levels = 1; levels < config.depth; levels++)
+    {
+        started = nowms();
+        if(deadline >= 0 && last > 0 &&
+           started + (before > 0 ? last * last / before : last) >= deadline)
+        {
+            break;
+        }
+        if(!this->round(levels, deadline))
+        {
+            break;
+        }
+        before = last;
+        last = max(nowms() - started, (int64_t)1);
+        this->depth = levels + 1;
+    }
+
+    // The first of the best moves in board order
+    best = 0;
+    for(int i = 1; i < n; i++)
+    {
+        if(this->jobs[i].score > this->jobs[best].score)
+        {
+            best = i;
+        }
+    }
+    this->score = this->jobs[best].score;
+    return this->jobs[best].square;
+}
+
+/**
+ * round: searches every root move `levels' levels below it on the
+ * workers. The scores are only kept if the round is complete.
+ *
+ * return: false if a tree stopped short, out of time or memory, or no
+ * workers are left.
+ */
+bool Cluster::round(int levels, int64_t deadline)
+{
+    vector< pair<unsigned long, int> > order;
+    vector<int> scores(this->jobs.size());
+    vector<unsigned long> sizes(this->jobs.size());
+    vector<struct pollfd> fds;
+    vector<int> polled;
+    deque<int> queue;
+    bool complete = true;
+    int running = 0, score, built;
+    unsigned long size;
+    char line[128];
+
+    for(unsigned int i = 0; i < this->jobs.size(); i++)
+    {
+        scores[i] = this->jobs[i].score;
+        sizes[i] = this->jobs[i].nodes;
+        if(!this->jobs[i].over)
+        {
+            order.push_back(make_pair(this->jobs[i].nodes, (int)i));
+        }
+    }
+    sort(order.begin(), order.end());
+    for(int i = (int)order.size() - 1; i >= 0; i--)
+    {
+        queue.push_back(order[i].second);
+    }
+
+    while((complete && !queue.empty()) || running > 0)
+    {
+        // Idle workers take the next biggest moves
+        for(unsigned int i = 0; i < this->workers.size(); i++)
+        {
+            Worker &worker = this->workers[i];
+            if(!complete || queue.empty() || worker.fd < 0 || worker.job >= 0)
+            {
+                continue;
+            }
+            if(this->assign(worker, queue.front(), levels, deadline))
+            {
+                queue.pop_front();
+                running++;
+            }
+        }
+        if(!running)
+        {
+            ERROR(__FILE__, __LINE__, "no workers left");
+            return false;
+        }
+
+        fds.clear();
+        polled.clear();
+        for(unsigned int i = 0; i < this->workers.size(); i++)
+        {
+            if(this->workers[i].job >= 0)
+            {
+                struct pollfd p;
+                p.fd = this->workers[i].fd;
+                p.events = POLLIN;
+                p.revents = 0;
+                fds.push_back(p);
+                polled.push_back(i);
+            }
+        }
+        if(poll(&fds[0], fds.size(), -1) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            ERROR(__FILE__, __LINE__, "poll: %s", strerror(errno));
+            exit(-1);
+        }
+
+        for(unsigned int k = 0; k < fds.size(); k++)
+        {
+            if(!fds[k].revents)
+            {
+                continue;
+            }
+            Worker &worker = this->workers[polled[k]];
+            Job &job = this->jobs[worker.job];
+            running--;
+            if(fgets(line, sizeof(line), worker.in) &&
+               sscanf(line, "%d %d %lu", &score, &built, &size) == 3)
+            {
+                scores[worker.job] = job.sign * score;
+                sizes[worker.job] = size;
+                this->nodes += size;
+                complete = complete && built >= levels;
+            }
+            else
+            {
+                // Someone else takes its move
+                WARN(__FILE__, __LINE__, "worker %d died",
+                     (int)worker.pid);
+                queue.push_front(worker.job);
+                fclose(worker.in);
+                worker.fd = -1;
+            }
+            worker.job = -1;
+        }
+    }
+
+    if(complete)
+    {
+        for(unsigned int i = 0; i < this->jobs.size(); i++)
+        {
+            this->jobs[i].score = scores[i];
+            this->jobs[i].nodes = sizes[i];
+        }
+    }
+    return complete;
+}
+
+/**
+ * assign: sends the root move `job' to an idle worker.
+ *
+ * return: false if the worker has died; it is then left out from now on.
+ */
+bool Cluster::assign(Worker &worker, int job, int levels, int64_t deadline)
+{
+    Board &board = this->jobs[job].board;
+    uint64_t black = board.discs(BLACK), white = board.discs(WHITE);
+    char line[128];
+    int n;
+
+    for(int i = 0; i < 64; i++)
+    {
+        line[i] = ((black >> i) & 1) ? 'b' : ((white >> i) & 1) ? 'w' : '-';
+    }
+    n = 64 + snprintf(line + 64, sizeof(line) - 64, " %c %d %ld\n",
+                      this->jobs[job].toMove == BLACK ? 'b' : 'w', levels,
+                      (long)deadline);
+
+    if(!sendAll(worker.fd, line, n))
+    {
+        WARN(__FILE__, __LINE__, "worker %d died", (int)worker.pid);
+        fclose(worker.in);
+        worker.fd = -1;
+        return false;
+    }
+    worker.job = job;
+    return true;
+}
+
+/**
+ * serve: the worker's side. Each job is searched by a Player of its own
+ * (see Player::think()) until the socket is closed.
+ */
+void Cluster::serve(int fd, size_t bytes, int flags)
+{
+    FILE *in = fdopen(fd, "r");
+    Brain brain(bytes, flags);
+    Player player(BLACK, &brain);
+    char line[256], squares[65], reply[64], toMove;
+    int levels, n;
+    long deadline;
+
+    while(fgets(line, sizeof(line), in))
+    {
+        if(sscanf(line, "%64s %c %d %ld", squares, &toMove, &levels,
+                  &deadline) != 4 || strlen(squares) != 64 || levels < 1)
+        {
+            ERROR(__FILE__, __LINE__, "bad job: %s", line);
+            break;
+        }
+
+        player.board.setBoard(squares);
+        player.side = (toMove == 'b') ? BLACK : WHITE;
+        player.think(levels, deadline);
+
+        n = snprintf(reply, sizeof(reply), "%d %d %lu\n", player.bestScore,
+                     player.lastDepth, player.lastNodes);
+        if(!sendAll(fd, reply, n))
+        {
+            break;
+        }
+    }
+    fclose(in);
+}
@@ -0,0 +1,80 @@
+#ifndef __CLUSTER_H__
+#define __CLUSTER_H__
+
+#include <cstdio>
+#include <vector>
+#include <sys/types.h>
+#include "common.h"
+#include "board.h"
+#include "alloc.h"
+
+using namespace std;
+
+/**
+ * Cluster: minimax split at the root over worker processes on this host,
+ * for when one process's tree is not enough. Each worker is a forked copy
+ * of the engine with a Brain of its own, spoken to over a socket pair, so
+ * every root move gets a whole tree and together the workers use as much
+ * memory and as many CPUs as there are of them.
+ *
+ * The root moves are searched in rounds, one depth at a time. A round's
+ * moves are queued largest first, going by the tree each needed in the
+ * previous round, and handed to whichever worker is idle, so workers that
+ * finish early take up the rest. A round that runs into the deadline or
+ * does not fit in a worker's brain ends the search, and the last complete
+ * round gives the move. One line goes each way per move searched:
+ *
+ *      <64 squares of '-', 'b', 'w'> <b|w to move> <levels> <deadline>
+ *      -> <score for the side to move> <levels built> <nodes>
+ *
+ * the deadline being on nowms()'s clock, which every process shares, or -1.
+ * Workers must be started before the process makes any threads.
+ */
+class Cluster
+{
+public:
+    Cluster(int workers, size_t bytes, int flags = ALLOC_DEFAULT);
+    ~Cluster();
+
+    int search(Board &board, Side side, int64_t deadline);
+
+    int size() { return (int)this->workers.size(); }
+
+    // Results of the last search(): the chosen move's score for `side', the
+    // depth of the last complete round, and tree nodes built by the workers
+    int score;
+    int depth;
+    unsigned long nodes;
+
+private:
+    struct Worker
+    {
+        pid_t pid;
+        int fd;             // our end of the socket pair, -1 once it died
+        FILE *in;           // replies, read from `fd'
+        int job;            // root move being searched, or -1 when idle
+    };
+
+    struct Job
+    {
+        int square;
+        Board board;        // after the move
+        Side toMove;        // who moves next, or searches from there
+        int sign;           // 1 if that is us, -1 if the opponent
+        bool over;          // nobody can move: `score' is final
+        int score;          // for us
+        unsigned long nodes;
+    };
+
+    vector<Worker> workers;
+    vector<Job> jobs;
+
+    bool round(int levels, int64_t deadline);
+    bool assign(Worker &worker, int job, int levels, int64_t deadline);
+    static void serve(int fd, size_t bytes, int flags);
+
+    Cluster(const Cluster &);
+    Cluster &operator=(const Cluster &);
+};
+
+#endif
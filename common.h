@@ -10,6 +10,21 @@ enum Side {
     WHITE, BLACK
 };
 
+inline Side enemyof(Side side)
+{
+    return (side == BLACK ? WHITE : BLACK);
+}
+
+/**
+ * EnemyOf: enemyof() at compile time, for code templated on the side to
+ * move.
+ */
+template <Side side>
+struct EnemyOf
+{
+    static const Side value = (side == BLACK ? WHITE : BLACK);
+};
+
 class Move {
    
 public:
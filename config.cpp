@@ -0,0 +1,367 @@
+#include "config.h"
+#include "board.h"
+#include "cache.h"
+#include "mcts.h"
+#include "network.h"
+#include "player.h"
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+#include <unistd.h>
+
+Config config;
+
+static const char *names[] = {
+    "memory", "cache-size", "threads", "workers", "depth", "time",
+    "move-time", "playouts", "near-end", "evaluator", "network", "win",
+    "corner", "adjacent-corner", "edge", "stable"
+};
+
+
+/*
+ * number: `value' as a whole number in [low, high].
+ *
+ * return: false, with a message naming `name', if it is anything else.
+ */
+static bool number(const string &name, const string &value, long low,
+                   long high, long &out)
+{
+    char *end;
+
+    errno = 0;
+    out = strtol(value.c_str(), &end, 10);
+    if(value.empty() || *end != '\0' || errno != 0 || out < low ||
+       out > high)
+    {
+        ERROR(__FILE__, __LINE__, "%s must be a number from %ld to %ld, not"
+              " '%s'", name.c_str(), low, high, value.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * Config: the compile-time defaults, with a thread per CPU.
+ */
+Config::Config()
+{
+    this->memory = MEMSIZE;
+    this->cacheSize = CACHE_SIZE;
+    this->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    this->workers = 0;
+    this->depth = SEARCH_DEPTH;
+    this->moveTime = 0;
+    this->playouts = MCTS_PLAYOUTS;
+    this->nearEnd = NEAREND;
+    this->win = WINSC;
+    this->corner = CORNSCR;
+    this->adjacentCorner = ADJCORNSCR;
+    this->edge = EDGESCR;
+    this->stable = STABLESCR;
+
+    if(this->threads < 1)
+    {
+        this->threads = 1;
+    }
+}
+
+/**
+ * shareClock: whether moves keep to a share of the clock, `fallback' being
+ * the player's own default for when `time' is not set.
+ */
+bool Config::shareClock(bool fallback) const
+{
+    return this->time.empty() ? fallback : this->time == "share";
+}
+
+/**
+ * fingerprint: a hash of what search scores depend on besides the position:
+ * the heuristic's weights, `nearEnd' and the network's weights if one is
+ * loaded. Results found under different ones must not be mixed (see
+ * SearchCache).
+ */
+uint64_t Config::fingerprint() const
+{
+    const int weights[] = { this->nearEnd, this->win, this->corner,
+                            this->adjacentCorner, this->edge, this->stable };
+    uint64_t hash = 14695981039346656037UL;     // FNV-1a
+
+    for(unsigned int i = 0; i < sizeof(weights); i++)
+    {
+        hash = (hash ^ ((const unsigned char *)weights)[i]) *
+               1099511628211UL;
+    }
+    if(::network.loaded)
+    {
+        const unsigned char *bytes = (const unsigned char *)::network.input;
+        size_t len = (const unsigned char *)&::network.outputBias -
+                     bytes + sizeof(::network.outputBias);
+        for(size_t i = 0; i < len; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211UL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * has: whether `name' is a setting.
+ */
+bool Config::has(const string &name) const
+{
+    for(unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if(name == names[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * set: sets `name' to `value'. The heuristic's weights are bounded so that
+ * no score can leave the int16 range or reach SEARCH_INF.
+ *
+ * return: false, with a message, if the setting is unknown or the value
+ * out of range; the setting is then unchanged.
+ */
+bool Config::set(const string &name, const string &value)
+{
+    long n;
+
+    if(name == "memory" || name == "cache-size")
+    {
+        if(!number(name, value, 1, 1000000, n))
+        {
+            return false;
+        }
+        (name == "memory" ? this->memory : this->cacheSize) =
+            (size_t)n * 1000000;
+    }
+    else if(name == "threads" || name == "workers")
+    {
+        if(!number(name, value, name == "threads" ? 1 : 0, 256, n))
+        {
+            return false;
+        }
+        (name == "threads" ? this->threads : this->workers) = (int)n;
+    }
+    else if(name == "depth")
+    {
+        if(!number(name, value, 1, CONFIG_MAXDEPTH, n))
+        {
+            return false;
+        }
+        this->depth = (int)n;
+    }
+    else if(name == "time")
+    {
+        if(value != "none" && value != "share" && value != "default")
+        {
+            ERROR(__FILE__, __LINE__, "time must be none, share or default,"
+                  " not '%s'", value.c_str());
+            return false;
+        }
+        this->time = (value == "default") ? "" : value;
+    }
+    else if(name == "move-time")
+    {
+        if(!number(name, value, 0, 86400000, n))
+        {
+            return false;
+        }
+        this->moveTime = (int)n;
+    }
+    else if(name == "playouts")
+    {
+        if(!number(name, value, 1, 1000000000, n))
+        {
+            return false;
+        }
+        this->playouts = n;
+    }
+    else if(name == "near-end")
+    {
+        if(!number(name, value, 4, 64, n))
+        {
+            return false;
+        }
+        this->nearEnd = (int)n;
+    }
+    else if(name == "evaluator")
+    {
+        if(value != "classic" && value != "network")
+        {
+            ERROR(__FILE__, __LINE__, "evaluator must be classic or network,"
+                  " not '%s'", value.c_str());
+            return false;
+        }
+        this->evaluator = value;
+    }
+    else if(name == "network")
+    {
+        if(value.empty())
+        {
+            ERROR(__FILE__, __LINE__, "network needs a file");
+            return false;
+        }
+        this->network = value;
+    }
+    else if(name == "win")
+    {
+        if(!number(name, value, 0, 1000, n))
+        {
+            return false;
+        }
+        this->win = (int)n;
+    }
+    else if(name == "corner" || name == "adjacent-corner" ||
+            name == "edge" || name == "stable")
+    {
+        if(!number(name, value, -100, 100, n))
+        {
+            return false;
+        }
+        (name == "corner" ? this->corner :
+         name == "adjacent-corner" ? this->adjacentCorner :
+         name == "edge" ? this->edge : this->stable) = (int)n;
+    }
+    else
+    {
+        ERROR(__FILE__, __LINE__, "unknown setting '%s'", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * load: reads settings from `file', one `name value' pair per line. Blank
+ * lines and lines starting with '#' are skipped.
+ *
+ * return: false at the first line that cannot be read or set; the lines
+ * before it have taken effect.
+ */
+bool Config::load(const char *file)
+{
+    char line[1024], name[64];
+    int lineno = 0, used;
+    FILE *in = fopen(file, "r");
+
+    if(in == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot open %s", file);
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), in))
+    {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if(sscanf(line, " %63s %n", name, &used) < 1 || name[0] == '#')
+        {
+            continue;
+        }
+
+        string value(line + used);
+        value.erase(value.find_last_not_of(" \t") + 1);
+        if(!this->set(name, value))
+        {
+            ERROR(__FILE__, __LINE__, "%s:%d: bad setting", file, lineno);
+            fclose(in);
+            return false;
+        }
+    }
+    fclose(in);
+    return true;
+}
+
+/**
+ * apply: checks the settings together and loads the network if it is the
+ * evaluator, which it is by default once a network file is given.
+ *
+ * return: false, with a message, if they do not go together.
+ */
+bool Config::apply()
+{
+    if(this->evaluator.empty())
+    {
+        this->evaluator = this->network.empty() ? "classic" : "network";
+    }
+    if(this->evaluator == "network")
+    {
+        if(this->network.empty())
+        {
+            ERROR(__FILE__, __LINE__, "the network evaluator needs a network"
+                  " file");
+            return false;
+        }
+        if(!::network.load(this->network.c_str()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * setting: appends `name' with `value' as set() takes it.
+ */
+template <typename T>
+static void setting(vector< pair<string, string> > &out, const char *name,
+                    const T &value)
+{
+    ostringstream text;
+
+    text << value;
+    out.push_back(make_pair(string(name), text.str()));
+}
+
+/**
+ * settings: the settings in effect as `name value' pairs that set() takes
+ * back, the network only if it is the evaluator.
+ */
+void Config::settings(vector< pair<string, string> > &out) const
+{
+    out.clear();
+    setting(out, "memory", this->memory / 1000000);
+    setting(out, "cache-size", this->cacheSize / 1000000);
+    setting(out, "threads", this->threads);
+    setting(out, "workers", this->workers);
+    setting(out, "depth", this->depth);
+    setting(out, "time", this->time.empty() ? "default" : this->time);
+    setting(out, "move-time", this->moveTime);
+    setting(out, "playouts", this->playouts);
+    setting(out, "near-end", this->nearEnd);
+    setting(out, "evaluator", this->evaluator.empty() ? "classic"
+                                                      : this->evaluator);
+    if(this->evaluator == "network")
+    {
+        setting(out, "network", this->network);
+    }
+    setting(out, "win", this->win);
+    setting(out, "corner", this->corner);
+    setting(out, "adjacent-corner", this->adjacentCorner);
+    setting(out, "edge", this->edge);
+    setting(out, "stable", this->stable);
+}
+
+/**
+ * log: writes the settings in effect, in the form load() reads, on two
+ * lines starting "Config:".
+ */
+void Config::log(ostream &out) const
+{
+    vector< pair<string, string> > pairs;
+
+    this->settings(pairs);
+    for(unsigned int i = 0; i < pairs.size(); i++)
+    {
+        out << ((i == 0 || pairs[i].first == "near-end") ? "Config:" : "")
+            << " " << pairs[i].first << " " << pairs[i].second
+            << ((i + 1 == pairs.size() || pairs[i + 1].first == "near-end")
+                ? "\n" : "");
+    }
+    out.flush();
+}
@@ -0,0 +1,80 @@
+#ifndef __CONFIG_H__
+#define __CONFIG_H__
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+#define CONFIG_MAXDEPTH (60)    // deepest tree the Node levels allow for
+
+using namespace std;
+
+/**
+ * Config: the engine settings that used to take a rebuild to change. The
+ * defaults are the compile-time values (MEMSIZE, SEARCH_DEPTH, NEAREND, the
+ * heuristic's weights in board.h, ...), so a program that never touches
+ * `config' plays as before. Settings are `name value' pairs, given on the
+ * player's command line as --name value or by load() from a file with one
+ * pair per line, later ones overriding earlier ones:
+ *
+ *      memory MB           game tree or Monte Carlo node pool per process;
+ *                          a server splits it between its threads, so more
+ *                          threads play more games at once but search each
+ *                          less deeply
+ *      cache-size MB       size of a new search cache file (see cache.h)
+ *      threads N           worker threads
+ *      workers N           worker processes (see cluster.h), 0 for none
+ *      depth N             deepest minimax tree, in plies
+ *      time none|share|default
+ *                          whether moves keep to a share of the clock; by
+ *                          default Monte Carlo and distributed play do and
+ *                          minimax does not
+ *      move-time MS        most time for any one move, 0 for no limit
+ *      playouts N          Monte Carlo playouts per move at most
+ *      near-end N          discs from which positions score the disc count
+ *      evaluator classic|network
+ *      network FILE        weights for the network evaluator (network.h)
+ *      win, corner, adjacent-corner, edge, stable N
+ *                          weights of Board::heuristic()
+ *
+ * set() and load() check each value as it comes; apply() checks the
+ * settings as a whole and loads the network.
+ */
+struct Config
+{
+    Config();
+
+    size_t memory;          // bytes
+    size_t cacheSize;       // bytes
+    int threads;
+    int workers;
+    int depth;
+    string time;            // "none" or "share"; empty for the default
+    int moveTime;           // ms
+    long playouts;
+    int nearEnd;
+    string evaluator;       // "classic" or "network"; empty until chosen
+    string network;
+
+    // Heuristic weights, for black discs and against white ones
+    int win;
+    int corner;
+    int adjacentCorner;
+    int edge;
+    int stable;
+
+    bool shareClock(bool fallback) const;
+    uint64_t fingerprint() const;
+    bool has(const string &name) const;
+    bool set(const string &name, const string &value);
+    bool load(const char *file);
+    bool apply();
+    void settings(vector< pair<string, string> > &out) const;
+    void log(ostream &out) const;
+};
+
+extern Config config;
+
+#endif
@@ -0,0 +1,376 @@
+#ifndef __GEOMETRY_H__
+#define __GEOMETRY_H__
+
+#include "common.h"
+
+// Boards of more than 64 squares need a 128-bit bitboard
+__extension__ typedef unsigned __int128 uint128;
+
+template <bool wide>
+struct BitsFor
+{
+    typedef uint64_t type;
+};
+
+template <>
+struct BitsFor<true>
+{
+    typedef uint128 type;
+};
+
+inline int bitCount(uint64_t b)
+{
+    return __builtin_popcountl(b);
+}
+
+inline int bitCount(uint128 b)
+{
+    return __builtin_popcountl((uint64_t)b) +
+           __builtin_popcountl((uint64_t)(b >> 64));
+}
+
+/**
+ * lowestBit: index of the lowest set bit; `b' must not be 0.
+ */
+inline int lowestBit(uint64_t b)
+{
+    return __builtin_ctzl(b);
+}
+
+inline int lowestBit(uint128 b)
+{
+    uint64_t low = (uint64_t)b;
+    return low ? __builtin_ctzl(low) : 64 + __builtin_ctzl((uint64_t)(b >> 64));
+}
+
+/**
+ * Geometry: the square layout of an N x N board (N even, 4 <= N <= 10).
+ * Square (x, y) is bit x + N*y of a bitboard. The masks are written as
+ * constant expressions of the template argument, so they fold away.
+ */
+template <int N>
+struct Geometry
+{
+    typedef typename BitsFor<(N * N > 64)>::type Bits;
+
+    enum { SIZE = N, SQUARES = N * N };
+
+    static Bits bit(int square)
+    {
+        return (Bits)1 << square;
+    }
+
+    // Every square of the board (and no bit beyond it)
+    static Bits all()
+    {
+        return ((((Bits)1 << (SQUARES - 1)) << 1) - 1);
+    }
+
+    // The column x = 0: bits 0, N, 2N, ...
+    static Bits firstColumn()
+    {
+        return all() / (((Bits)1 << N) - 1);
+    }
+
+    static Bits lastColumn()
+    {
+        return firstColumn() << (N - 1);
+    }
+
+    static Bits firstRow()
+    {
+        return ((Bits)1 << N) - 1;
+    }
+
+    static Bits lastRow()
+    {
+        return firstRow() << (N * (N - 1));
+    }
+
+    static Bits edges()
+    {
+        return firstColumn() | lastColumn() | firstRow() | lastRow();
+    }
+
+    static Bits corners()
+    {
+        return bit(0) | bit(N - 1) | bit(N * (N - 1)) | bit(N * N - 1);
+    }
+
+    // The 2N - 1 diagonals running each way, indexed by x - y + N - 1 and
+    // x + y respectively
+    struct Diagonals
+    {
+        Bits down[2 * N - 1], up[2 * N - 1];
+
+        Diagonals()
+        {
+            for(int i = 0; i < 2 * N - 1; i++)
+            {
+                down[i] = up[i] = 0;
+            }
+            for(int i = 0; i < SQUARES; i++)
+            {
+                down[i % N - i / N + N - 1] |= bit(i);
+                up[i % N + i / N] |= bit(i);
+            }
+        }
+    };
+
+    static const Diagonals &diagonals()
+    {
+        static const Diagonals table;
+        return table;
+    }
+};
+
+/*
+ * shiftDir: moves every disc of a bitboard one step in direction D (the
+ * change in square index), dropping those that would wrap around an edge or
+ * fall off the board.
+ */
+template <int N, int D>
+inline typename Geometry<N>::Bits shiftDir(typename Geometry<N>::Bits b)
+{
+    typedef Geometry<N> G;
+    const int n = (D > 0) ? D : -D;
+    const typename G::Bits mask =
+        (D == 1 || D == N + 1 || D == 1 - N) ? G::all() & ~G::firstColumn() :
+        (D == -1 || D == -N - 1 || D == N - 1) ? G::all() & ~G::lastColumn() :
+        G::all();
+    return ((D > 0) ? (b << n) : (b >> n)) & mask;
+}
+
+/*
+ * Fill: extends the runs of `opp' discs in `x' K more steps in direction D,
+ * unrolled at compile time.
+ */
+template <int N, int D, int K>
+struct Fill
+{
+    static typename Geometry<N>::Bits run(typename Geometry<N>::Bits x,
+                                          typename Geometry<N>::Bits opp)
+    {
+        return Fill<N, D, K - 1>::run(x | (shiftDir<N, D>(x) & opp), opp);
+    }
+};
+
+template <int N, int D>
+struct Fill<N, D, 0>
+{
+    static typename Geometry<N>::Bits run(typename Geometry<N>::Bits x,
+                                          typename Geometry<N>::Bits)
+    {
+        return x;
+    }
+};
+
+/*
+ * movesDir: the empty squares from which `own' discs can be reached in
+ * direction D over an unbroken run of `opp' discs (at most N - 2 long).
+ */
+template <int N, int D>
+inline typename Geometry<N>::Bits movesDir(typename Geometry<N>::Bits own,
+                                           typename Geometry<N>::Bits opp,
+                                           typename Geometry<N>::Bits empty)
+{
+    typename Geometry<N>::Bits x = shiftDir<N, D>(own) & opp;
+    return shiftDir<N, D>(Fill<N, D, N - 3>::run(x, opp)) & empty;
+}
+
+/*
+ * flipsDir: the `opp' discs a disc placed on `from' flips in direction D.
+ */
+template <int N, int D>
+inline typename Geometry<N>::Bits flipsDir(typename Geometry<N>::Bits from,
+                                           typename Geometry<N>::Bits own,
+                                           typename Geometry<N>::Bits opp)
+{
+    typename Geometry<N>::Bits flips = 0, x = shiftDir<N, D>(from);
+    while(x & opp)
+    {
+        flips |= x;
+        x = shiftDir<N, D>(x);
+    }
+    return (x & own) ? flips : 0;
+}
+
+/**
+ * GridBoard: an N x N board reduced to what move generation needs: one
+ * bitboard per side, indexed by Side, and the kernels for a side to move
+ * known at compile time. The engine's Board is GridBoard<8> plus the
+ * heuristic; the solver (see solver.h) works on any size.
+ */
+template <int N>
+class GridBoard
+{
+public:
+    typedef Geometry<N> G;
+    typedef typename G::Bits Bits;
+
+    GridBoard();
+
+    template <Side side> Bits movesFor() const;
+    template <Side side> Bits flipsFor(int square) const;
+    template <Side side> void play(int square);
+    template <Side side> void play(int square, Bits flips);
+    template <Side side> void undo(int square, Bits flips);
+
+    Bits stable(Side side) const;
+
+    Bits discs(Side side) const { return bits[side]; }
+    int count(Side side) const { return bitCount(bits[side]); }
+    int empties() const { return G::SQUARES - bitCount(bits[0] | bits[1]); }
+
+protected:
+    Bits bits[2];
+};
+
+/*
+ * The standard setup: the four centre squares, white on the main diagonal.
+ */
+template <int N>
+inline GridBoard<N>::GridBoard()
+{
+    const int c = N / 2 - 1;
+    bits[WHITE] = G::bit(c + N * c) | G::bit(c + 1 + N * (c + 1));
+    bits[BLACK] = G::bit(c + 1 + N * c) | G::bit(c + N * (c + 1));
+}
+
+/*
+ * Legal moves for `side' as a bitboard.
+ */
+template <int N>
+template <Side side>
+inline typename GridBoard<N>::Bits GridBoard<N>::movesFor() const
+{
+    Bits own = bits[side], opp = bits[EnemyOf<side>::value];
+    Bits empty = G::all() & ~(own | opp);
+    return movesDir<N, 1>(own, opp, empty)
+         | movesDir<N, -1>(own, opp, empty)
+         | movesDir<N, N>(own, opp, empty)
+         | movesDir<N, -N>(own, opp, empty)
+         | movesDir<N, N + 1>(own, opp, empty)
+         | movesDir<N, -N - 1>(own, opp, empty)
+         | movesDir<N, N - 1>(own, opp, empty)
+         | movesDir<N, 1 - N>(own, opp, empty);
+}
+
+/*
+ * The discs `side' flips by playing on `square', which must be empty. The
+ * move is legal if and only if this is not 0.
+ */
+template <int N>
+template <Side side>
+inline typename GridBoard<N>::Bits GridBoard<N>::flipsFor(int square) const
+{
+    Bits own = bits[side], opp = bits[EnemyOf<side>::value];
+    Bits from = G::bit(square);
+    return flipsDir<N, 1>(from, own, opp)
+         | flipsDir<N, -1>(from, own, opp)
+         | flipsDir<N, N>(from, own, opp)
+         | flipsDir<N, -N>(from, own, opp)
+         | flipsDir<N, N + 1>(from, own, opp)
+         | flipsDir<N, -N - 1>(from, own, opp)
+         | flipsDir<N, N - 1>(from, own, opp)
+         | flipsDir<N, 1 - N>(from, own, opp);
+}
+
+/*
+ * Plays the legal move `square' for `side'.
+ */
+template <int N>
+template <Side side>
+inline void GridBoard<N>::play(int square)
+{
+    play<side>(square, flipsFor<side>(square));
+}
+
+/*
+ * play() for a caller that already has the move's flips.
+ */
+template <int N>
+template <Side side>
+inline void GridBoard<N>::play(int square, Bits flips)
+{
+    bits[side] |= flips | G::bit(square);
+    bits[EnemyOf<side>::value] &= ~flips;
+}
+
+/*
+ * Takes back the move `square' by `side' that flipped `flips', so a search
+ * can make and unmake moves on one board instead of copying it.
+ */
+template <int N>
+template <Side side>
+inline void GridBoard<N>::undo(int square, Bits flips)
+{
+    bits[side] &= ~(flips | G::bit(square));
+    bits[EnemyOf<side>::value] |= flips;
+}
+
+/*
+ * Returns the discs of the given side that can never be flipped. A disc is
+ * stable when along each of the four lines through it the line is full, the
+ * disc sits on the edge, or its neighbour on that line is a stable disc of
+ * the same colour. Starting from none, this grows out of the corners until
+ * nothing changes. The result is a subset of the truly stable discs.
+ */
+template <int N>
+typename GridBoard<N>::Bits GridBoard<N>::stable(Side side) const
+{
+    const typename G::Diagonals &diagonals = G::diagonals();
+    Bits own = bits[side], occ = bits[WHITE] | bits[BLACK];
+    Bits fullH = 0, fullV = 0, fullD = 0, fullA = 0, line;
+    Bits st = 0, last;
+    int i;
+
+    if(!own)
+    {
+        return 0;
+    }
+
+    for(i = 0; i < N; i++)
+    {
+        line = G::firstRow() << (N * i);
+        if((occ & line) == line)
+        {
+            fullH |= line;
+        }
+        line = G::firstColumn() << i;
+        if((occ & line) == line)
+        {
+            fullV |= line;
+        }
+    }
+    for(i = 0; i < 2 * N - 1; i++)
+    {
+        if((occ & diagonals.down[i]) == diagonals.down[i])
+        {
+            fullD |= diagonals.down[i];
+        }
+        if((occ & diagonals.up[i]) == diagonals.up[i])
+        {
+            fullA |= diagonals.up[i];
+        }
+    }
+
+    fullH |= G::firstColumn() | G::lastColumn();
+    fullV |= G::firstRow() | G::lastRow();
+    fullD |= G::edges();
+    fullA |= G::edges();
+
+    do
+    {
+        last = st;
+        st = own
+           & (fullH | shiftDir<N, 1>(st) | shiftDir<N, -1>(st))
+           & (fullV | shiftDir<N, N>(st) | shiftDir<N, -N>(st))
+           & (fullD | shiftDir<N, N + 1>(st) | shiftDir<N, -N - 1>(st))
+           & (fullA | shiftDir<N, N - 1>(st) | shiftDir<N, 1 - N>(st));
+    } while(st != last);
+
+    return st;
+}
+
+#endif
@@ -0,0 +1,330 @@
+#include "mcts.h"
+#include "search.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+
+/*
+ * pick: a move from the bitboard `legal', which must not be empty. The
+ * playout policy is random except that a corner is always taken, which
+ * costs nothing and keeps the playouts from giving them away.
+ */
+static inline int pick(uint64_t legal, Random &random)
+{
+    if(legal & Board::G::corners())
+    {
+        legal &= Board::G::corners();
+    }
+    for(int k = random.below(__builtin_popcountl(legal)); k > 0; k--)
+    {
+        legal &= legal - 1;
+    }
+    return __builtin_ctzl(legal);
+}
+
+/*
+ * outcome: the result of a finished game for `side', in half points.
+ */
+template <Side side>
+static inline int outcome(const Board &board)
+{
+    int diff = board.count(side) - board.count(EnemyOf<side>::value);
+    return (diff > 0) ? 2 : (diff == 0) ? 1 : 0;
+}
+
+/*
+ * playout: plays random moves from `board', `side' to move, to the end of
+ * the game and returns its result for `side'. Two plies are unrolled per
+ * pass of the loop, so each side's moves are generated by its own kernel.
+ */
+template <Side side>
+static int playout(Board board, Random &random)
+{
+    const Side other = EnemyOf<side>::value;
+    uint64_t legal;
+
+    for(;;)
+    {
+        legal = board.movesFor<side>();
+        if(legal)
+        {
+            board.play<side>(pick(legal, random));
+        }
+        else if(!board.movesFor<other>())
+        {
+            break;
+        }
+
+        legal = board.movesFor<other>();
+        if(legal)
+        {
+            board.play<other>(pick(legal, random));
+        }
+        else if(!board.movesFor<side>())
+        {
+            break;
+        }
+    }
+    return outcome<side>(board);
+}
+
+
+/**
+ * MctsTask: one thread of MonteCarlo::search(), running playouts from the
+ * root until the playouts or the time are used up.
+ */
+class MctsTask : public Task
+{
+public:
+    MctsTask(MonteCarlo *search, const Board &board, Side side,
+             uint64_t seed) : board(board), random(seed)
+    {
+        this->search = search;
+        this->side = side;
+    }
+
+    void run(int)
+    {
+        MonteCarlo *search = this->search;
+        MctsNode *root = &search->pool[0];
+        unsigned long done = 0;
+        Board board;
+
+        while(!search->stopped &&
+              __sync_fetch_and_add(&search->issued, 1) < search->limit)
+        {
+            if(search->deadline >= 0 && !(done & 63) &&
+               nowms() >= search->deadline)
+            {
+                search->stopped = true;
+                break;
+            }
+            board = this->board;
+            __sync_fetch_and_add(&root->visits, 1);
+            if(this->side == BLACK)
+            {
+                search->descend<BLACK>(root, board, this->random);
+            }
+            else
+            {
+                search->descend<WHITE>(root, board, this->random);
+            }
+            done++;
+        }
+        __sync_fetch_and_add(&search->playouts, done);
+    }
+
+private:
+    MonteCarlo *search;
+    Board board;
+    Side side;
+    Random random;
+};
+
+
+/**
+ * MonteCarlo: allocates a pool of `bytes' bytes of nodes through bigAlloc()
+ * (see Brain, which does the same for its tree), and faults it in.
+ */
+MonteCarlo::MonteCarlo(size_t bytes, int flags)
+{
+    this->len = bytes/sizeof(MctsNode);
+    this->pool = (MctsNode *)bigAlloc(this->len * sizeof(MctsNode), flags,
+                                      this->alloc);
+    if(this->pool == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot allocate %lu bytes of tree",
+              (unsigned long)bytes);
+        exit(-1);
+    }
+    memset((void *)this->pool, 0, this->len * sizeof(MctsNode));
+
+    this->threads = 1;
+    this->limit = MCTS_PLAYOUTS;
+    this->playouts = 0;
+    this->ms = 0;
+    this->percent = 0;
+    this->used = 0;
+    this->issued = 0;
+    this->stopped = false;
+    this->deadline = -1;
+    this->workers = NULL;
+}
+
+MonteCarlo::~MonteCarlo()
+{
+    delete this->workers;
+    bigFree(this->pool, this->alloc);
+}
+
+/**
+ * search: runs `limit' playouts from `board', `side' to move, on `threads'
+ * threads, or fewer if the clock reaches `deadline' first (-1 for none).
+ * The threads are started by the first search and kept for the next ones,
+ * unless `threads' has changed in between.
+ * Each thread's random moves are seeded from `seed', so one thread with the
+ * same seed plays the same way every time.
+ *
+ * return: the most visited move as a square index x + 8*y, or -1 to pass.
+ */
+int MonteCarlo::search(const Board &board, Side side, int64_t deadline,
+                       uint64_t seed)
+{
+    int64_t started = nowms();
+    MctsNode *root = &this->pool[0], *best;
+    bool expanded;
+
+    root->child = NULL;
+    root->visits = 0;
+    root->wins = 0;
+    root->state = MCTS_LEAF;
+    root->square = -1;
+    root->children = 0;
+
+    this->used = 1;
+    this->issued = 0;
+    this->stopped = false;
+    this->deadline = deadline;
+    this->playouts = 0;
+    this->percent = 0;
+
+    expanded = (side == BLACK) ? this->expand<BLACK>(root, board)
+                               : this->expand<WHITE>(root, board);
+    if(!expanded || !root->children)
+    {
+        this->ms = (int)(nowms() - started);
+        return -1;
+    }
+
+    if(this->workers == NULL ||
+       this->workers->size() != max(this->threads, 1))
+    {
+        delete this->workers;
+        this->workers = new ThreadPool(max(this->threads, 1));
+    }
+    for(int i = 0; i < this->workers->size(); i++)
+    {
+        this->workers->submit(new MctsTask(this, board, side,
+                                           seed + i * 0x9E3779B97F4A7C15UL));
+    }
+    this->workers->wait();
+
+    // The most visited move is the one the search trusts most
+    best = &root->child[0];
+    for(int i = 1; i < root->children; i++)
+    {
+        if(root->child[i].visits > best->visits)
+        {
+            best = &root->child[i];
+        }
+    }
+    this->percent = best->visits
+                  ? (int)(50 * (int64_t)best->wins / best->visits) : 50;
+    this->ms = (int)(nowms() - started);
+    return best->square;
+}
+
+/**
+ * expand: gives `node' a child for each legal move of `side', or a single
+ * pass, or none if the game is over. Only one thread expands a node; the
+ * others go on treating it as a leaf until it is done.
+ *
+ * return: false if another thread has the node or the pool is full.
+ */
+template <Side side>
+bool MonteCarlo::expand(MctsNode *node, const Board &board)
+{
+    const Side other = EnemyOf<side>::value;
+    uint64_t legal = board.movesFor<side>();
+    int n = legal ? __builtin_popcountl(legal)
+                  : (board.movesFor<other>() ? 1 : 0);
+    MctsNode *child;
+    size_t first;
+
+    if(this->used + n > this->len ||
+       !__sync_bool_compare_and_swap(&node->state, MCTS_LEAF,
+                                     MCTS_EXPANDING))
+    {
+        return false;
+    }
+    first = __sync_fetch_and_add(&this->used, (size_t)n);
+    if(first + n > this->len)
+    {
+        node->state = MCTS_LEAF;
+        return false;
+    }
+
+    child = &this->pool[first];
+    for(int i = 0; i < n; i++)
+    {
+        child[i].child = NULL;
+        child[i].visits = 0;
+        child[i].wins = 0;
+        child[i].state = MCTS_LEAF;
+        child[i].square = legal ? __builtin_ctzl(legal) : -1;
+        child[i].children = 0;
+        legal &= legal - 1;
+    }
+    node->child = child;
+    node->children = n;
+    __sync_synchronize();
+    node->state = MCTS_EXPANDED;
+    return true;
+}
+
+/**
+ * descend: one playout through `node', `side' to move on `board'. A leaf
+ * that has been visited before is expanded; otherwise the playout starts
+ * there. Within the tree the child with the best UCT value is followed,
+ * unvisited children first.
+ *
+ * return: the result for `side', in half points.
+ */
+template <Side side>
+int MonteCarlo::descend(MctsNode *node, Board &board, Random &random)
+{
+    const Side other = EnemyOf<side>::value;
+    MctsNode *child, *best = NULL;
+    double value, bestValue = -1, logVisits;
+    int n, result;
+
+    if(node->state != MCTS_EXPANDED &&
+       (node->visits <= MCTS_VIRTUAL || !this->expand<side>(node, board)))
+    {
+        return playout<side>(board, random);
+    }
+    if(!node->children)
+    {
+        return outcome<side>(board);
+    }
+
+    logVisits = log((double)node->visits);
+    for(int i = 0; i < node->children; i++)
+    {
+        child = &node->child[i];
+        n = child->visits;
+        if(!n)
+        {
+            best = child;
+            break;
+        }
+        value = child->wins / (2.0 * n) + MCTS_EXPLORE * sqrt(logVisits / n);
+        if(value > bestValue)
+        {
+            bestValue = value;
+            best = child;
+        }
+    }
+
+    // Count a loss until the result is in, so other threads look elsewhere
+    __sync_fetch_and_add(&best->visits, MCTS_VIRTUAL);
+    if(best->square >= 0)
+    {
+        board.play<side>(best->square);
+    }
+    result = 2 - this->descend<other>(best, board, random);
+    __sync_fetch_and_add(&best->wins, result);
+    __sync_fetch_and_add(&best->visits, 1 - MCTS_VIRTUAL);
+    return result;
+}
@@ -0,0 +1,86 @@
+#ifndef __MCTS_H__
+#define __MCTS_H__
+
+#include "common.h"
+#include "board.h"
+#include "alloc.h"
+#include "random.h"
+#include "threadpool.h"
+
+#define MCTS_MEMSIZE (256000000)    // bytes of node pool
+#define MCTS_PLAYOUTS (200000)      // playouts per move without a clock
+#define MCTS_EXPLORE (1.0)          // UCT exploration constant
+#define MCTS_VIRTUAL (3)            // losses a thread adds on its way down
+
+#define MCTS_LEAF (0)
+#define MCTS_EXPANDING (1)
+#define MCTS_EXPANDED (2)
+
+using namespace std;
+
+/**
+ * MctsNode: a position in the Monte Carlo tree, reached by playing `square'
+ * (-1 for a pass). The statistics are for the side that played it, in half
+ * points: a win is 2, a draw 1. The children are `children' consecutive
+ * nodes of the pool, there once `state' is MCTS_EXPANDED.
+ */
+struct MctsNode
+{
+    MctsNode *child;
+    volatile int visits;    // playouts through here, plus virtual losses
+    volatile int wins;
+    volatile int state;
+    int8_t square;
+    uint8_t children;
+};
+
+/**
+ * MonteCarlo: Monte Carlo tree search, an alternative to the minimax over
+ * the Brain that needs no heuristic. Every thread walks down the one shared
+ * tree by UCT, adds a level where it leaves the tree and finishes the game
+ * with a random playout. A thread adds virtual losses to the nodes it passes
+ * until its result is in, which steers the others onto different lines. The
+ * nodes come from one pool, allocated like the Brain's tree; once it is full
+ * the tree stops growing and the playouts go on from its leaves.
+ */
+class MonteCarlo
+{
+public:
+    MonteCarlo(size_t bytes = MCTS_MEMSIZE, int flags = ALLOC_DEFAULT);
+    ~MonteCarlo();
+
+    int search(const Board &board, Side side, int64_t deadline,
+               uint64_t seed);
+
+    const MctsNode &root() const { return this->pool[0]; }
+
+    int threads;            // threads to search with
+    long limit;             // playouts per search()
+
+    // Statistics of the last search()
+    unsigned long playouts;
+    int ms;
+    int percent;            // of the chosen move's playouts won, draws half
+
+    MctsNode *pool;
+    size_t len;             // number of nodes in `pool'
+    AllocInfo alloc;        // how `pool' was allocated (see alloc.h)
+
+private:
+    volatile size_t used;   // nodes of `pool' handed out
+    volatile long issued;   // playouts started
+    volatile bool stopped;  // the deadline passed
+    int64_t deadline;
+    ThreadPool *workers;    // kept from one search() to the next
+
+    friend class MctsTask;
+
+    template <Side side> bool expand(MctsNode *node, const Board &board);
+    template <Side side> int descend(MctsNode *node, Board &board,
+                                     Random &random);
+
+    MonteCarlo(const MonteCarlo &);
+    MonteCarlo &operator=(const MonteCarlo &);
+};
+
+#endif
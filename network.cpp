@@ -0,0 +1,358 @@
+#include "network.h"
+#include <cstdio>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+Network network;
+
+
+/*
+ * addRow: to = from + row, over a first-layer vector. SSE2 adds eight
+ * lanes at a time; it is always there on x86-64.
+ */
+static inline void addRow(int16_t *to, const int16_t *from,
+                          const int16_t *row)
+{
+#ifdef __SSE2__
+    for(int i = 0; i < NN_HIDDEN; i += 8)
+    {
+        _mm_store_si128((__m128i *)(to + i),
+            _mm_add_epi16(_mm_load_si128((const __m128i *)(from + i)),
+                          _mm_load_si128((const __m128i *)(row + i))));
+    }
+#else
+    for(int i = 0; i < NN_HIDDEN; i++)
+    {
+        to[i] = from[i] + row[i];
+    }
+#endif
+}
+
+/*
+ * subRow: to = from - row.
+ */
+static inline void subRow(int16_t *to, const int16_t *from,
+                          const int16_t *row)
+{
+#ifdef __SSE2__
+    for(int i = 0; i < NN_HIDDEN; i += 8)
+    {
+        _mm_store_si128((__m128i *)(to + i),
+            _mm_sub_epi16(_mm_load_si128((const __m128i *)(from + i)),
+                          _mm_load_si128((const __m128i *)(row + i))));
+    }
+#else
+    for(int i = 0; i < NN_HIDDEN; i++)
+    {
+        to[i] = from[i] - row[i];
+    }
+#endif
+}
+
+/*
+ * dot: the int32 dot product of `n' int16 lanes, n a multiple of 8.
+ */
+static inline int32_t dot(const int16_t *a, const int16_t *b, int n)
+{
+#ifdef __SSE2__
+    __m128i sum = _mm_setzero_si128();
+    for(int i = 0; i < n; i += 8)
+    {
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(
+            _mm_load_si128((const __m128i *)(a + i)),
+            _mm_load_si128((const __m128i *)(b + i))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for(int i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+static inline int16_t clip(int32_t x)
+{
+    return (int16_t)(x < 0 ? 0 : x > NN_ONE ? NN_ONE : x);
+}
+
+
+/**
+ * Network: all weights zero and not loaded, so the classic heuristic is
+ * used.
+ */
+Network::Network()
+{
+    memset(this->input, 0, sizeof(this->input));
+    memset(this->bias, 0, sizeof(this->bias));
+    memset(this->dense, 0, sizeof(this->dense));
+    memset(this->denseBias, 0, sizeof(this->denseBias));
+    memset(this->output, 0, sizeof(this->output));
+    this->outputBias = 0;
+    this->loaded = false;
+    this->prepare();
+}
+
+void Network::prepare()
+{
+    for(int square = 0; square < 64; square++)
+    {
+        for(int i = 0; i < NN_HIDDEN; i++)
+        {
+            int16_t black = this->input[feature(BLACK, square)][i];
+            int16_t white = this->input[feature(WHITE, square)][i];
+            this->flip[BLACK][square][i] = black - white;
+            this->flip[WHITE][square][i] = white - black;
+        }
+    }
+}
+
+/**
+ * refresh: sums the first layer of `board' from scratch.
+ */
+void Network::refresh(Accumulator &acc, const Board &board) const
+{
+    uint64_t b;
+
+    memcpy(acc.v, this->bias, sizeof(acc.v));
+    for(b = board.discs(BLACK); b; b &= b - 1)
+    {
+        addRow(acc.v, acc.v,
+               this->input[feature(BLACK, __builtin_ctzl(b))]);
+    }
+    for(b = board.discs(WHITE); b; b &= b - 1)
+    {
+        addRow(acc.v, acc.v,
+               this->input[feature(WHITE, __builtin_ctzl(b))]);
+    }
+}
+
+/**
+ * update: `to' is `from' after `side' plays on `square', flipping `flips'.
+ * Each flipped disc costs one row, its change of colour.
+ */
+template <Side side>
+void Network::update(Accumulator &to, const Accumulator &from, int square,
+                     uint64_t flips) const
+{
+    addRow(to.v, from.v, this->input[feature(side, square)]);
+    for(; flips; flips &= flips - 1)
+    {
+        addRow(to.v, to.v, this->flip[side][__builtin_ctzl(flips)]);
+    }
+}
+
+template void Network::update<BLACK>(Accumulator &, const Accumulator &, int,
+                                     uint64_t) const;
+template void Network::update<WHITE>(Accumulator &, const Accumulator &, int,
+                                     uint64_t) const;
+
+/**
+ * change: turns `acc', the first layer of `from', into that of `to'. Each
+ * square that differs costs one row, so going between two boards a few
+ * moves apart in the tree is much cheaper than refresh().
+ */
+void Network::change(Accumulator &acc, const Board &from,
+                     const Board &to) const
+{
+    uint64_t fromBlack = from.discs(BLACK), fromWhite = from.discs(WHITE);
+    uint64_t toBlack = to.discs(BLACK), toWhite = to.discs(WHITE), b;
+
+    for(b = toBlack & fromWhite; b; b &= b - 1)
+    {
+        addRow(acc.v, acc.v, this->flip[BLACK][__builtin_ctzl(b)]);
+    }
+    for(b = toWhite & fromBlack; b; b &= b - 1)
+    {
+        addRow(acc.v, acc.v, this->flip[WHITE][__builtin_ctzl(b)]);
+    }
+    for(b = fromBlack & ~(toBlack | toWhite); b; b &= b - 1)
+    {
+        subRow(acc.v, acc.v, this->input[feature(BLACK, __builtin_ctzl(b))]);
+    }
+    for(b = fromWhite & ~(toBlack | toWhite); b; b &= b - 1)
+    {
+        subRow(acc.v, acc.v, this->input[feature(WHITE, __builtin_ctzl(b))]);
+    }
+    for(b = toBlack & ~(fromBlack | fromWhite); b; b &= b - 1)
+    {
+        addRow(acc.v, acc.v, this->input[feature(BLACK, __builtin_ctzl(b))]);
+    }
+    for(b = toWhite & ~(fromBlack | fromWhite); b; b &= b - 1)
+    {
+        addRow(acc.v, acc.v, this->input[feature(WHITE, __builtin_ctzl(b))]);
+    }
+}
+
+/**
+ * evaluate: the score for black of the position summed in `acc', in discs.
+ */
+int Network::evaluate(const Accumulator &acc) const
+{
+    int16_t hidden[NN_HIDDEN] __attribute__((aligned(16)));
+    int16_t second[NN_DENSE] __attribute__((aligned(16)));
+    int i;
+
+    for(i = 0; i < NN_HIDDEN; i++)
+    {
+        hidden[i] = clip(acc.v[i]);
+    }
+    for(i = 0; i < NN_DENSE; i++)
+    {
+        second[i] = clip((dot(hidden, this->dense[i], NN_HIDDEN) +
+                          this->denseBias[i]) / NN_WEIGHT);
+    }
+    return (int)((int64_t)(dot(second, this->output, NN_DENSE) +
+                           this->outputBias) * NN_SCALE /
+                 (NN_ONE * NN_WEIGHT));
+}
+
+int Network::evaluate(const Board &board) const
+{
+    Accumulator acc;
+    this->refresh(acc, board);
+    return this->evaluate(acc);
+}
+
+/**
+ * load: reads weights written by save(): a line
+ *
+ *      network <inputs> <hidden> <dense>
+ *
+ * that must match this build, then the weights and biases of each layer in
+ * turn as integers. '#' lines before it are comments.
+ *
+ * return: false if the file cannot be read or does not fit; the weights in
+ * use are then left alone.
+ */
+bool Network::load(const char *file)
+{
+    char line[256];
+    int inputs = 0, hidden = 0, dense = 0, i, j, v, ok = 1;
+    bool header;
+    FILE *in = fopen(file, "r");
+    Network *read = new Network();
+
+    if(in == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot open %s", file);
+        delete read;
+        return false;
+    }
+
+    while((header = (fgets(line, sizeof(line), in) != NULL)) &&
+          line[0] == '#')
+    {
+    }
+    if(!header ||
+       sscanf(line, "network %d %d %d", &inputs, &hidden, &dense) != 3 ||
+       inputs != NN_INPUTS || hidden != NN_HIDDEN || dense != NN_DENSE)
+    {
+        ERROR(__FILE__, __LINE__, "%s is not a %dx%dx%d network", file,
+              NN_INPUTS, NN_HIDDEN, NN_DENSE);
+        fclose(in);
+        delete read;
+        return false;
+    }
+
+    for(i = 0; ok && i < NN_INPUTS; i++)
+    {
+        for(j = 0; ok && j < NN_HIDDEN; j++)
+        {
+            ok = fscanf(in, "%d", &v) == 1;
+            read->input[i][j] = (int16_t)v;
+        }
+    }
+    for(j = 0; ok && j < NN_HIDDEN; j++)
+    {
+        ok = fscanf(in, "%d", &v) == 1;
+        read->bias[j] = (int16_t)v;
+    }
+    for(i = 0; ok && i < NN_DENSE; i++)
+    {
+        for(j = 0; ok && j < NN_HIDDEN; j++)
+        {
+            ok = fscanf(in, "%d", &v) == 1;
+            read->dense[i][j] = (int16_t)v;
+        }
+        ok = ok && fscanf(in, "%d", &read->denseBias[i]) == 1;
+    }
+    for(i = 0; ok && i < NN_DENSE; i++)
+    {
+        ok = fscanf(in, "%d", &v) == 1;
+        read->output[i] = (int16_t)v;
+    }
+    ok = ok && fscanf(in, "%d", &read->outputBias) == 1;
+    fclose(in);
+
+    if(!ok)
+    {
+        ERROR(__FILE__, __LINE__, "%s: truncated weights", file);
+        delete read;
+        return false;
+    }
+
+    memcpy(this->input, read->input, sizeof(this->input));
+    memcpy(this->bias, read->bias, sizeof(this->bias));
+    memcpy(this->dense, read->dense, sizeof(this->dense));
+    memcpy(this->denseBias, read->denseBias, sizeof(this->denseBias));
+    memcpy(this->output, read->output, sizeof(this->output));
+    this->outputBias = read->outputBias;
+    delete read;
+
+    this->prepare();
+    this->loaded = true;
+    return true;
+}
+
+/**
+ * save: writes the weights in the format read by load(), one row of a
+ * layer per line.
+ */
+bool Network::save(const char *file)
+{
+    int i, j;
+    FILE *out = fopen(file, "w");
+
+    if(out == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot write %s", file);
+        return false;
+    }
+
+    fprintf(out, "# first layer by input, its bias, dense layer by output"
+                 " with its bias, output\n");
+    fprintf(out, "network %d %d %d\n", NN_INPUTS, NN_HIDDEN, NN_DENSE);
+    for(i = 0; i < NN_INPUTS; i++)
+    {
+        for(j = 0; j < NN_HIDDEN; j++)
+        {
+            fprintf(out, "%d%c", this->input[i][j],
+                    j + 1 < NN_HIDDEN ? ' ' : '\n');
+        }
+    }
+    for(j = 0; j < NN_HIDDEN; j++)
+    {
+        fprintf(out, "%d%c", this->bias[j], j + 1 < NN_HIDDEN ? ' ' : '\n');
+    }
+    for(i = 0; i < NN_DENSE; i++)
+    {
+        for(j = 0; j < NN_HIDDEN; j++)
+        {
+            fprintf(out, "%d ", this->dense[i][j]);
+        }
+        fprintf(out, "%d\n", this->denseBias[i]);
+    }
+    for(i = 0; i < NN_DENSE; i++)
+    {
+        fprintf(out, "%d ", this->output[i]);
+    }
+    fprintf(out, "%d\n", this->outputBias);
+    return fclose(out) == 0;
+}
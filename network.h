@@ -0,0 +1,81 @@
+#ifndef __NETWORK_H__
+#define __NETWORK_H__
+
+#include "common.h"
+#include "board.h"
+
+#define NN_INPUTS (128)     // a black and a white feature for each square
+#define NN_HIDDEN (64)      // first layer, kept in the Accumulator
+#define NN_DENSE (32)       // second layer
+#define NN_ONE (127)        // an activation of 1.0, quantized
+#define NN_WEIGHT (64)      // a weight of 1.0 in the dense layers, quantized
+#define NN_SCALE (64)       // discs per unit of the network's output
+
+using namespace std;
+
+/**
+ * Accumulator: the first layer of the network for one position, the sum of
+ * the weights of its discs. A move changes only a few discs, so this is
+ * updated from the parent's rather than summed again.
+ */
+struct Accumulator
+{
+    int16_t v[NN_HIDDEN] __attribute__((aligned(16)));
+};
+
+/**
+ * Network: a small quantized evaluator in the style of NNUE, an alternative
+ * to Board::heuristic(). Feature x + 8*y is a black disc on that square and
+ * 64 + x + 8*y a white one. The first layer sums their int16 weights in an
+ * Accumulator; two dense layers with clipped ReLU activations in
+ * [0, NN_ONE] then give the score for black, in discs like heuristic(). The
+ * weights are trained by `train' (see train.cpp), which writes files in the
+ * format read by load(). Until they are loaded the classic heuristic stays
+ * in use.
+ */
+class Network
+{
+public:
+    Network();
+
+    bool loaded;
+
+    bool load(const char *file);
+    bool save(const char *file);
+
+    void refresh(Accumulator &acc, const Board &board) const;
+    template <Side side>
+    void update(Accumulator &to, const Accumulator &from, int square,
+                uint64_t flips) const;
+    void change(Accumulator &acc, const Board &from, const Board &to) const;
+    int evaluate(const Accumulator &acc) const;
+    int evaluate(const Board &board) const;
+
+    // Weights, quantized: the first layer and its bias by NN_ONE, the dense
+    // layers by NN_WEIGHT and their biases by NN_ONE * NN_WEIGHT
+    int16_t input[NN_INPUTS][NN_HIDDEN] __attribute__((aligned(16)));
+    int16_t bias[NN_HIDDEN] __attribute__((aligned(16)));
+    int16_t dense[NN_DENSE][NN_HIDDEN] __attribute__((aligned(16)));
+    int32_t denseBias[NN_DENSE];
+    int16_t output[NN_DENSE] __attribute__((aligned(16)));
+    int32_t outputBias;
+
+private:
+    // flip[side][square]: the change when a disc on `square' turns to
+    // `side', derived from `input' by prepare()
+    int16_t flip[2][64][NN_HIDDEN] __attribute__((aligned(16)));
+
+    void prepare();
+};
+
+extern Network network;
+
+/*
+ * Feature of a disc of `side' on `square'.
+ */
+inline int feature(Side side, int square)
+{
+    return (side == BLACK) ? square : 64 + square;
+}
+
+#endif
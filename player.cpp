@@ -1,5 +1,9 @@
 #include "player.h"
+#include "config.h"
+#include "search.h"
+#include <algorithm>
 #include <map>
+#include <new>
 #include <stdlib.h>
 #include <vector>
 #include <cstdlib>
@@ -10,17 +14,38 @@
 using namespace std;
 
 /**
- * Brain: initializer for the "Brain" class (see `player.h')
+ * Brain: initializer for the "Brain" class (see `player.h'). The tree is
+ * allocated in one block of `bytes' bytes (MEMSIZE by default) by bigAlloc(),
+ * on huge pages if `flags' asks for them, since the tree is walked through
+ * pointers in no particular order and TLB misses dominate otherwise.
+ * Constructing the nodes touches every page, so the memory is faulted in
+ * here rather than during the first move.
  */
-Brain::Brain()
+Brain::Brain(size_t bytes, int flags)
 {
-    this->tree = new Node [(int)(MEMSIZE/sizeof(Node))];
+    this->len = bytes/sizeof(Node);
+    this->tree = (Node *)bigAlloc(this->len * sizeof(Node), flags,
+                                  this->alloc);
+    if(this->tree == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot allocate %lu bytes of tree",
+              (unsigned long)bytes);
+        exit(-1);
+    }
+    for(unsigned int i = 0; i < this->len; i++)
+    {
+        new (&this->tree[i]) Node();
+    }
     this->bottomlevel = 0;
 }
 
 Brain::~Brain()
 {
-    delete [] this->tree;
+    for(unsigned int i = 0; i < this->len; i++)
+    {
+        this->tree[i].~Node();
+    }
+    bigFree(this->tree, this->alloc);
 }
 
 
@@ -31,28 +56,61 @@ Brain::~Brain()
  * on (BLACK or WHITE) is passed in as "side". The constructor must finish 
  * within 30 seconds.
  */
-Player::Player(Side side) {
+Player::Player(Side side) : reply(0, 0) {
     // Will be set to true in test_minimax.cpp.
     testingMinimax = false;
 
     this->side = side;
+    this->brain = new Brain(config.memory);
+    this->ownsBrain = true;
+    this->cache = NULL;
+    this->lastDepth = 0;
+    this->lastNodes = 0;
+    this->lastMs = 0;
+    this->bestScore = 0;
+    this->deterministic = false;
+    this->random.seed(time(NULL));
+    this->mcts = NULL;
+    this->cluster = NULL;
+    this->neural = network.loaded;
 }
 
 /*
- * Destructor for the player.
+ * Constructor for a player that borrows its brain. This is used when many
+ * games share a few brains (see `server.cpp'): the brain may be NULL here and
+ * must be attached before each call to doMove().
  */
-Player::~Player() {
-}
+Player::Player(Side side, Brain *brain) : reply(0, 0) {
+    testingMinimax = false;
 
+    this->side = side;
+    this->brain = brain;
+    this->ownsBrain = false;
+    this->cache = NULL;
+    this->lastDepth = 0;
+    this->lastNodes = 0;
+    this->lastMs = 0;
+    this->bestScore = 0;
+    this->deterministic = false;
+    this->random.seed(time(NULL));
+    this->mcts = NULL;
+    this->cluster = NULL;
+    this->neural = network.loaded;
+}
 
-inline Side enemyof(Side side)
-{
-    return (side == BLACK ? WHITE : BLACK);
+/*
+ * Destructor for the player.
+ */
+Player::~Player() {
+    if(this->ownsBrain)
+    {
+        delete this->brain;
+    }
 }
 
 
 inline void initNode(Node &current, Node *ancestor, uint8_t level, int16_t score,
-        Board board, Side lastmove, Node *child, Node *sibling)
+        const Board &board, Side lastmove, Node *child, Node *sibling)
 {
     current.ancestor = ancestor;
     current.level = level;
@@ -73,10 +131,14 @@ inline void initNode(Node &current, Node *ancestor, uint8_t level, int16_t score
  * be disqualified! An msLeft value of -1 indicates no time limit.
  *
  * The move returned must be legal; if there are no valid moves for your side,
- * return NULL.
+ * return NULL. It is the player's own `reply', overwritten by the next call,
+ * so the caller must not delete it.
  */
 Move *Player::doMove(Move *opponentsMove, int msLeft) {
-    Move * return_move = new Move(0, 0);          // return move
+    Move *return_move = &this->reply;             // return move
+    int64_t started = nowms();
+    this->lastNodes = 0;
+    this->lastMs = 0;
     // update board
     if(this->side == BLACK){
         this->board.doMove(opponentsMove, WHITE);
@@ -90,54 +152,207 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
         return NULL;        // if game is over, no move is possible
     }
 
+    if(this->mcts != NULL)
+    {
+        return this->doMonteCarlo(return_move, msLeft, started);
+    }
+    if(this->cluster != NULL)
+    {
+        return this->doDistributed(return_move, msLeft, started);
+    }
+
+    // A deep enough result from an earlier game is played right away.
+    uint64_t key = 0;
+    CacheEntry entry;
+    if(this->cache != NULL)
+    {
+        key = SearchCache::hash(this->board, this->side);
+        if(this->cache->probe(key, entry) && entry.bound == CACHE_EXACT &&
+           !entry.selective && entry.move >= 0 &&
+           entry.depth >= max(this->lastDepth, CACHE_PLAYERDEPTH))
+        {
+            return_move->x = entry.move % 8;
+            return_move->y = entry.move / 8;
+            if(this->board.checkMove(return_move, this->side))
+            {
+                this->bestScore = entry.score;
+                this->lastDepth = entry.depth;
+                this->lastNodes = 0;
+                this->lastMs = (int)(nowms() - started);
+                this->board.doMove(return_move, this->side);
+                return return_move;
+            }
+        }
+    }
+
+
+
+    Node *return_node = this->think(config.depth,
+        this->deadlineFor(msLeft, started, config.shareClock(false)));
+
+    return_move->x = return_node->ancestor->x;
+    return_move->y = return_node->ancestor->y;
+    
+    if(this->cache != NULL)
+    {
+        entry.score = this->bestScore;
+        entry.depth = this->brain->bottomlevel;
+        entry.bound = CACHE_EXACT;
+        entry.move = return_move->x + 8*return_move->y;
+        entry.selective = false;
+        entry.tree = true;
+        this->cache->store(key, entry);
+    }
+
+    this->board.doMove(return_move, this->side);
+    this->lastMs = (int)(nowms() - started);
+    return return_move;
+}
 
 
+/**
+ * think: builds the tree below `board' one complete level at a time, up to
+ * `levels' levels, for as long as the next level fits and, unless
+ * `deadline' is -1, looks like being done before it (see levelInTime()).
+ * The tree is then searched by findMinimax() and reset.
+ *
+ * return: the chosen child of the root. bestScore is its score, and
+ * lastDepth and lastNodes the depth and size of the tree.
+ */
+Node *Player::think(int levels, int64_t deadline)
+{
     //// Allocate space for our tree:
     //Node *tree = new Node [(int)(MEMSIZE/sizeof(Node))];
-    int start, end, newend;
+    int start, end, newend, previous;
+    int64_t begun = nowms();
 
     // Construct the first node
-    initNode(this->brain.tree[0], NULL, 0, 0, this->board, enemyof(this->side), 
+    initNode(this->brain->tree[0], NULL, 0, 0, this->board, enemyof(this->side), 
              NULL, NULL);
 
 
-    // Fill the "tree"
+    // Fill the "tree" one complete level at a time, for as long as the next
+    // level fits
     start = 1;  
     end = this->buildFirstLevel();
-    this->brain.bottomlevel = 1;
+    this->brain->bottomlevel = 1;
+    previous = 1;
 
-    for(int i = 1; i < SEARCH_DEPTH; i++)
+    for(int i = 1; i < levels; i++)
     { 
+        if(!this->levelInTime(start, end, previous, begun, deadline) ||
+           !this->levelFits(start, end, previous))
+        {
+            break;
+        }
         newend = this->buildLevel(start, end);
         if(!newend)
         {
-            break; // If we've run out of memory
+            // Undo the part that was built, so no node on the bottom level
+            // is searched deeper than the others
+            for(int idx = start; idx < end; idx++)
+            {
+                this->brain->tree[idx].child = NULL;
+            }
+            break;
         }
+        previous = end - start;
         start = end;
         end = newend;
-        this->brain.bottomlevel++;
+        this->brain->bottomlevel++;
     }
 
-    //cerr << "MEMORY USED: " << 100*((double)end)/((double)MEMLEN) 
+    //cerr << "MEMORY USED: " << 100*((double)end)/((double)this->brain->len) 
     //                        << "%" << endl;
 
 
     Node *return_node = this->findMinimax();
 
-    return_move->x = return_node->ancestor->x;
-    return_move->y = return_node->ancestor->y;
-    
+    this->lastDepth = this->brain->bottomlevel;
+    this->lastNodes = end;
 
-    // Reset our tree so that it does not confuse our minimax method.
-    for(unsigned int i = 0; i < MEMLEN; i++)
+    // Reset our tree so that it does not confuse our minimax method. Only
+    // the nodes built this time were touched.
+    for(int i = 0; i < end; i++)
+    {
+        this->brain->tree[i].level = 127;
+    }
+
+    return return_node;
+}
+
+/**
+ * deadlineFor: when a move begun at `started' has to be done, -1 for no
+ * limit. With `share' that is an even share of `msLeft' over our remaining
+ * moves, and never later than config.moveTime from the start. There is no
+ * limit in deterministic mode, where only depth, memory and playouts may
+ * stop a search, so that it does the same on any machine.
+ */
+int64_t Player::deadlineFor(int msLeft, int64_t started, bool share)
+{
+    if(this->deterministic)
     {
-        this->brain.tree[i].level = 127;
+        return -1;
     }
 
+    int moves = (this->board.empties() + 1) / 2;
+    int64_t deadline = (share && msLeft > 0)
+                     ? started + msLeft / max(moves, 1) : -1;
+
+    if(config.moveTime > 0 &&
+       (deadline < 0 || deadline > started + config.moveTime))
+    {
+        deadline = started + config.moveTime;
+    }
+    return deadline;
+}
+
+/**
+ * doMonteCarlo: doMove() by Monte Carlo tree search. Without a clock it runs
+ * the playouts set in `mcts'; with one, it also stops at an even share of
+ * the time left over our remaining moves unless `time' is set to none (see
+ * config.h). The score reported is the percent of the chosen move's
+ * playouts won.
+ */
+Move *Player::doMonteCarlo(Move *return_move, int msLeft, int64_t started)
+{
+    int square = this->mcts->search(this->board, this->side,
+                                    this->deadlineFor(msLeft, started,
+                                                      config.shareClock(true)),
+                                    this->random.next());
+
+    return_move->x = square % 8;
+    return_move->y = square / 8;
+
+    this->bestScore = this->mcts->percent;
+    this->lastDepth = 0;
+    this->lastNodes = this->mcts->playouts;
     this->board.doMove(return_move, this->side);
+    this->lastMs = (int)(nowms() - started);
     return return_move;
 }
 
+/**
+ * doDistributed: doMove() by the worker processes of `cluster', with the
+ * same share of the clock as doMonteCarlo(). The depth reported is that of
+ * the last complete round.
+ */
+Move *Player::doDistributed(Move *return_move, int msLeft, int64_t started)
+{
+    int square = this->cluster->search(this->board, this->side,
+                                       this->deadlineFor(msLeft, started,
+                                           config.shareClock(true)));
+
+    return_move->x = square % 8;
+    return_move->y = square / 8;
+
+    this->bestScore = this->cluster->score;
+    this->lastDepth = this->cluster->depth;
+    this->lastNodes = this->cluster->nodes;
+    this->board.doMove(return_move, this->side);
+    this->lastMs = (int)(nowms() - started);
+    return return_move;
+}
 
 /**
  * buildLevel: This function reads through a specified range of nodes in the
@@ -150,42 +365,135 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
  * tree.
  */
 int Player::buildLevel(int start, int end)
+{
+    // The same side is to move throughout a level, since a pass takes a level
+    // of its own: we are on the even levels
+    bool ours = !(this->brain->tree[start].level & 1);
+
+    if(this->side == BLACK)
+    {
+        return ours ? this->buildLevelFor<BLACK, BLACK>(start, end)
+                    : this->buildLevelFor<BLACK, WHITE>(start, end);
+    }
+    return ours ? this->buildLevelFor<WHITE, WHITE>(start, end)
+                : this->buildLevelFor<WHITE, BLACK>(start, end);
+}
+
+/**
+ * levelSize: the number of nodes buildLevel() would add below the nodes in
+ * [start, end): one per legal move, or one for a pass.
+ */
+int Player::levelSize(int start, int end)
+{
+    int size = 0, moves;
+    for(int idx = start; idx < end; idx++)
+    {
+        moves = __builtin_popcountl(this->brain->tree[idx].board.moves(
+            enemyof(this->brain->tree[idx].lastmove)));
+        size += moves ? moves : 1;
+    }
+    return size;
+}
+
+/**
+ * levelFits: whether the level below [start, end) fits in what is left of the
+ * tree. `previous' is the size of the level above, so the two give the
+ * branching factor. The next level is taken to be that much bigger again;
+ * only when that comes close to the space left is it counted exactly, which
+ * costs a pass over the level but never more than a fraction of building it.
+ */
+bool Player::levelFits(int start, int end, int previous)
+{
+    double size = end - start, left = (double)this->brain->len - end;
+    if(size * size / previous * 2 < left)
+    {
+        return true;
+    }
+    return (unsigned int)(end + this->levelSize(start, end)) <
+           this->brain->len;
+}
+
+/**
+ * levelInTime: whether the level below [start, end), sized as in
+ * levelFits(), can be built before `deadline' (-1 for none). Building
+ * costs about the same per node at every level, so the time taken since
+ * `begun' for the `end' nodes so far gives the cost of the next; it is
+ * taken PLAYER_TIMEMARGIN times over, to leave time for findMinimax().
+ */
+bool Player::levelInTime(int start, int end, int previous, int64_t begun,
+                         int64_t deadline)
+{
+    int64_t now = nowms();
+    double size = end - start;
+
+    if(deadline < 0)
+    {
+        return true;
+    }
+    return now + (double)(now - begun) / end * size * size / previous *
+                 PLAYER_TIMEMARGIN < deadline;
+}
+
+/**
+ * buildLevelFor: buildLevel() for a player on side `us' and a level with
+ * `mover' to move, so that the moves are made and the scores polarized at
+ * compile time. Children are generated from the bitboard of legal moves, in
+ * the same order as scanning the board.
+ */
+template <Side us, Side mover>
+int Player::buildLevelFor(int start, int end)
 {
     int idx, outidx, i, j;
-    Board currBrd, newBrd;
-    Move move (0, 0);
     uint8_t level;
     Node *sibling;
+    uint64_t legal;
 
-    // Sign to account for the polarity of our heuristic. See `board.cpp'
-    int8_t sign = (this->side == BLACK ? 1 : -1);
     int16_t score;
 
-    Side currSide;
+    uint64_t flips;
+    bool neural;
+    Accumulator parentAcc, childAcc;
+    const Board *summed = NULL;
     
     for(idx = start, outidx = end; idx < end; idx++)
     {
-        level = this->brain.tree[idx].level;
-        currBrd = this->brain.tree[idx].board; // fetch the board
-        currSide = enemyof(this->brain.tree[idx].lastmove);
+        level = this->brain->tree[idx].level;
+        Board &currBrd = this->brain->tree[idx].board;
+        legal = currBrd.movesFor<mover>();
     
+        // The network is only used for children near enough the end. The
+        // nodes of a level come in families, so the first layer is carried
+        // over from the last node summed, changing only what differs
         sibling = NULL;
+        neural = this->neural && currBrd.countBlack() +
+                 currBrd.countWhite() + 1 <= config.nearEnd;
+        if(legal && neural)
+        {
+            if(summed == NULL)
+            {
+                network.refresh(parentAcc, currBrd);
+            }
+            else
+            {
+                network.change(parentAcc, *summed, currBrd);
+            }
+            summed = &currBrd;
+        }
 
-        if(!currBrd.hasMoves(currSide)) // In this case this side cannot move.
+        if(!legal) // In this case this side cannot move.
         {
-            newBrd = currBrd;
-            score = this->brain.tree[idx].score;
+            score = this->brain->tree[idx].score;
 
-            initNode(this->brain.tree[outidx], NULL, level+1, score,
-                     newBrd, currSide, NULL, sibling);
+            initNode(this->brain->tree[outidx], NULL, level+1, score,
+                     currBrd, mover, NULL, sibling);
 
-            this->brain.tree[outidx].ancestor = 
-            this->brain.tree[idx].ancestor;
+            this->brain->tree[outidx].ancestor = 
+            this->brain->tree[idx].ancestor;
 
-            this->brain.tree[idx].child = &this->brain.tree[outidx];
+            this->brain->tree[idx].child = &this->brain->tree[outidx];
 
             outidx++;
-            if((unsigned int)outidx >= MEMLEN)
+            if((unsigned int)outidx >= this->brain->len)
             {
 
                 WARN(__FILE__, __LINE__, "OUT OF MEMORY AT LEVEL %d!", level);
@@ -196,26 +504,35 @@ int Player::buildLevel(int start, int end)
             {
                 for(j = 0; j < BRDSIZE; j++)
                 {
-                    move.x = i;
-                    move.y = j;
-                    if(currBrd.checkMove(&move, currSide))
+                    if((legal >> (i + 8*j)) & 1)
                     {
-                        newBrd = currBrd;
-                        newBrd.doMove(&move, currSide);
+                        // The child's board is made in its node, straight
+                        // from the parent's
+                        Node &child = this->brain->tree[outidx];
+                        initNode(child, NULL, level+1, 0, currBrd, mover,
+                                 NULL, sibling);
+                        flips = currBrd.flipsFor<mover>(i + 8*j);
+                        child.board.play<mover>(i + 8*j, flips);
+                        if(neural)
+                        {
+                            network.update<mover>(childAcc, parentAcc,
+                                                  i + 8*j, flips);
+                        }
 
-                        // Use our heuristic:
-                        score = sign*(newBrd.heuristic()); 
+                        // Use our heuristic (or the network), polarized for
+                        // us:
+                        score = neural ? network.evaluate(childAcc)
+                                       : child.board.heuristic();
+                        child.score = (us == BLACK) ? score : -score;
                         
-                        initNode(this->brain.tree[outidx], NULL, level+1, score,
-                                 newBrd, currSide, NULL, sibling);
-                        sibling = &this->brain.tree[outidx];
+                        sibling = &this->brain->tree[outidx];
 
-                        this->brain.tree[outidx].ancestor = 
-                        this->brain.tree[idx].ancestor;
+                        this->brain->tree[outidx].ancestor = 
+                        this->brain->tree[idx].ancestor;
 
                         outidx++;
                         
-                        if((unsigned int)outidx >= MEMLEN)
+                        if((unsigned int)outidx >= this->brain->len)
                         {
                             WARN(__FILE__, __LINE__, 
                                            "OUT OF MEMORY AT LEVEL %d!", level);
@@ -224,7 +541,7 @@ int Player::buildLevel(int start, int end)
                     }
                 }
             }
-            this->brain.tree[idx].child = &this->brain.tree[outidx-1];
+            this->brain->tree[idx].child = &this->brain->tree[outidx-1];
         }
     }
     return outidx;
@@ -237,52 +554,57 @@ int Player::buildLevel(int start, int end)
  * position.
  */
 int Player::buildFirstLevel()
+{
+    return (this->side == BLACK) ? this->buildFirstLevelFor<BLACK>()
+                                 : this->buildFirstLevelFor<WHITE>();
+}
+
+/**
+ * buildFirstLevelFor: buildFirstLevel() for a player on side `us'.
+ */
+template <Side us>
+int Player::buildFirstLevelFor()
 {
     int outidx, i, j;
-    Board currBrd, newBrd;
-    Move move (0, 0);
+    uint64_t legal, flips;
 
     Node *sibling = NULL;
 
-    // Sign to account for the polarity of our heuristic. See `board.cpp'
-    int8_t sign = (this->side == BLACK ? 1 : -1);
     int16_t score;
-
-    Side currSide;
     
-    currBrd = this->brain.tree[0].board; // fetch the board
-    currSide = this->side;
+    Board &currBrd = this->brain->tree[0].board; // fetch the board
+    legal = currBrd.movesFor<us>();
     outidx = 1;
 
     for(i = 0; i < BRDSIZE; i++)
     {
         for(j = 0; j < BRDSIZE; j++)
         {
-            move.x = i;
-            move.y = j;
-            if(currBrd.checkMove(&move, currSide))
+            if((legal >> (i + 8*j)) & 1)
             {
-                newBrd = currBrd;
-                newBrd.doMove(&move, currSide);
-
-                // Use our heuristic:
-                score = sign*(newBrd.heuristic()); 
-                
-                initNode(this->brain.tree[outidx], NULL, 1, score,
-                         newBrd, currSide, NULL, sibling);
-                sibling = &this->brain.tree[outidx];
+                // The child's board is made in its node
+                Node &child = this->brain->tree[outidx];
+                initNode(child, NULL, 1, 0, currBrd, us, NULL, sibling);
+                flips = currBrd.flipsFor<us>(i + 8*j);
+                child.board.play<us>(i + 8*j, flips);
+
+                // Use our heuristic (or the network), polarized for us:
+                score = (this->neural && child.board.countBlack() +
+                         child.board.countWhite() <= config.nearEnd)
+                      ? network.evaluate(child.board)
+                      : child.board.heuristic();
+                child.score = (us == BLACK) ? score : -score;
+                sibling = &child;
                 
-                this->brain.tree[outidx].ancestor = 
-                &(this->brain.tree[outidx]);
-
-                this->brain.tree[outidx].x = i;
-                this->brain.tree[outidx].y = j;
+                child.ancestor = &child;
+                child.x = i;
+                child.y = j;
 
                 outidx++;
             }
         }
     }
-    this->brain.tree[0].child = &this->brain.tree[outidx-1];
+    this->brain->tree[0].child = &this->brain->tree[outidx-1];
 
     return outidx;
 }
@@ -290,6 +612,17 @@ int Player::buildFirstLevel()
 
 
 int16_t Player::minimax(Node *node, int8_t depth, bool maximizingPlayer)
+{
+    return maximizingPlayer ? this->minimaxFor<true>(node, depth)
+                            : this->minimaxFor<false>(node, depth);
+}
+
+/**
+ * minimaxFor: minimax() with the player to move fixed at compile time; the
+ * levels alternate between the two instantiations.
+ */
+template <bool maximizing>
+int16_t Player::minimaxFor(Node *node, int8_t depth)
 {
     int16_t best, v;
     Node *read;
@@ -297,30 +630,16 @@ int16_t Player::minimax(Node *node, int8_t depth, bool maximizingPlayer)
     {
         return node->score;
     }
-    if(maximizingPlayer)
+    best = maximizing ? - INFTY : INFTY;
+    read = node->child;
+    while(read) // go through the children
     {
-        best = - INFTY;
-        read = node->child;
-        while(read) // go through the children
-        {
-            v = minimax(read, depth - 1, false);
-            best = max(best, v);
-
-            read = read->sibling;
-        }
-        return best;
-    } else {
-        best = INFTY;
-        read = node->child;
-        while(read) // go through the children
-        {
-            v = minimax(read, depth - 1, true);
-            best = min(best, v);
+        v = minimaxFor<!maximizing>(read, depth - 1);
+        best = maximizing ? max(best, v) : min(best, v);
 
-            read = read->sibling;
-        }
-        return best;
+        read = read->sibling;
     }
+    return best;
 }
 
 
@@ -331,12 +650,10 @@ int16_t Player::minimax(Node *node, int8_t depth, bool maximizingPlayer)
 //*/
 Node * Player::findMinimax(){
 
-    srand(time(NULL));
-
     std::map<Node *, int16_t> options;
     std::map<Node *, int16_t>::iterator it;
     
-    Node *read = this->brain.tree[0].child;
+    Node *read = this->brain->tree[0].child;
 
     int16_t maximumMin = -INFTY;
     Node *outNode = NULL;
@@ -345,7 +662,7 @@ Node * Player::findMinimax(){
     // bad: 
     while(read)
     {
-        options[read] = minimax(read, this->brain.bottomlevel, false);
+        options[read] = minimaxFor<false>(read, this->brain->bottomlevel);
         read = read->sibling;
     }
 
@@ -370,7 +687,11 @@ Node * Player::findMinimax(){
         }
     }
 
-    int choice = rand() % bestmoves.size();
+    this->bestScore = maximumMin;
+
+    // In deterministic mode the first best move in board order is played
+    int choice = this->deterministic ? 0 :
+                 this->random.below(bestmoves.size());
 
     outNode = bestmoves[choice];
 
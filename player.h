@@ -4,11 +4,18 @@
 #include <iostream>
 #include "common.h"
 #include "board.h"
-
-#define MEMSIZE (750000000)
-#define MEMLEN (MEMSIZE/sizeof(Node))
+#include "alloc.h"
+#include "cache.h"
+#include "cluster.h"
+#include "mcts.h"
+#include "network.h"
+#include "random.h"
+
+#define MEMSIZE (750000000)     // default of config.memory (see config.h)
 #define BRDSIZE (8)
-#define SEARCH_DEPTH (10)
+#define SEARCH_DEPTH (10)       // default of config.depth
+#define CACHE_PLAYERDEPTH (6)   // shallowest cached result played outright
+#define PLAYER_TIMEMARGIN (2)   // next level's time estimate, this much over
 
 using namespace std;
 
@@ -45,11 +52,17 @@ struct Node
 struct Brain
 {
     Node *tree;
+    unsigned int len;       // number of nodes in `tree'
+    AllocInfo alloc;        // how `tree' was allocated (see alloc.h)
 
     uint8_t bottomlevel;
 
-    Brain();
+    Brain(size_t bytes = MEMSIZE, int flags = ALLOC_DEFAULT);
     ~Brain();
+
+private:
+    Brain(const Brain &);
+    Brain &operator=(const Brain &);
 };
 
 
@@ -58,23 +71,72 @@ class Player {
 
 public:
     Player(Side side);
+    Player(Side side, Brain *brain);
     ~Player();
     
     Board board;
     Side side;
 
-    Brain brain;
+    Brain *brain;
+    bool ownsBrain;
+
+    // Results shared with other games and processes, or NULL. Our own moves
+    // are stored with the depth they were searched to.
+    SearchCache *cache;
+    int lastDepth;          // depth the previous move was searched to
+    int16_t bestScore;      // score of the move findMinimax() chose
+
+    // Statistics of the previous move: tree nodes built and time taken
+    unsigned long lastNodes;
+    int lastMs;
+
+    // Ties between equally good moves are broken with `random', or always
+    // the same way in deterministic mode, for reproducible benchmarks. That
+    // mode also ignores the clock (see deadlineFor()).
+    bool deterministic;
+    Random random;
 
+    // Plays by Monte Carlo tree search instead of minimax over the brain if
+    // not NULL, and then the brain may be NULL too (see mcts.h)
+    MonteCarlo *mcts;
+
+    // Splits the search over worker processes instead if not NULL (see
+    // cluster.h); the brain may then be NULL too
+    Cluster *cluster;
+
+    // Evaluates with the network rather than Board::heuristic(); set when
+    // its weights were loaded before the player was made (see network.h)
+    bool neural;
+
+    // Returns `reply', so no move is allocated; it is only good until the
+    // next call
     Move *doMove(Move *opponentsMove, int msLeft);
+    Move reply;
 
     // Flag to tell if the player is running within the test_minimax context
     bool testingMinimax;
 
     int buildLevel(int start, int end);
+    int levelSize(int start, int end);
     int buildFirstLevel();
+    Node *think(int levels, int64_t deadline);
 
     int16_t minimax(Node *node, int8_t depth, bool maximizingPlayer);
     Node *findMinimax();
+
+private:
+    Move *doMonteCarlo(Move *return_move, int msLeft, int64_t started);
+    Move *doDistributed(Move *return_move, int msLeft, int64_t started);
+    int64_t deadlineFor(int msLeft, int64_t started, bool share);
+    bool levelInTime(int start, int end, int previous, int64_t begun,
+                     int64_t deadline);
+    template <Side us, Side mover> int buildLevelFor(int start, int end);
+    template <Side us> int buildFirstLevelFor();
+    bool levelFits(int start, int end, int previous);
+    template <bool maximizing> int16_t minimaxFor(Node *node, int8_t depth);
+
+    Player(const Player &);
+    Player &operator=(const Player &);
 };
 
 
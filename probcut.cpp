@@ -0,0 +1,230 @@
+#include "probcut.h"
+#include <cstdio>
+#include <cstring>
+
+ProbCut probCut;
+
+/*
+ * Built-in parameters, from `calibrate --positions 240 --depth 8'. Stage 6
+ * (a full board) never has moves to search and uses the fit over all stages.
+ */
+static const struct
+{
+    int stage, deep, shallow;
+    float a, b, sigma;
+} defaults[] = {
+    { 0,  3, 1, 0.8451f, 1.1486f, 1.3294f },
+    { 0,  4, 2, 0.7862f, -1.1762f, 1.4525f },
+    { 0,  5, 1, 0.7254f, 1.8396f, 1.9483f },
+    { 0,  6, 2, 0.8287f, -1.8126f, 1.5435f },
+    { 0,  7, 1, 0.8732f, 2.1567f, 2.0824f },
+    { 0,  7, 3, 1.1365f, 0.6770f, 1.1495f },
+    { 0,  8, 2, 0.8036f, -2.0362f, 2.2275f },
+    { 0,  8, 4, 1.0733f, -0.6738f, 1.4086f },
+    { 1,  3, 1, 0.9593f, 0.2953f, 2.7976f },
+    { 1,  4, 2, 0.9611f, -0.6096f, 3.4931f },
+    { 1,  5, 1, 0.9651f, 0.1612f, 5.0778f },
+    { 1,  6, 2, 1.0006f, -0.7494f, 4.5405f },
+    { 1,  7, 1, 0.9568f, 0.7251f, 6.1703f },
+    { 1,  7, 3, 1.0648f, -0.0869f, 4.7674f },
+    { 1,  8, 2, 1.0212f, -0.8542f, 5.5337f },
+    { 1,  8, 4, 1.1074f, -0.1367f, 3.3136f },
+    { 2,  3, 1, 0.9633f, 0.9579f, 4.8257f },
+    { 2,  4, 2, 1.0052f, 0.6453f, 4.7646f },
+    { 2,  5, 1, 0.9574f, 1.3003f, 6.8275f },
+    { 2,  6, 2, 0.9741f, 0.2206f, 6.9564f },
+    { 2,  7, 1, 0.9555f, 2.3696f, 8.6090f },
+    { 2,  7, 3, 1.0405f, 0.9559f, 5.5769f },
+    { 2,  8, 2, 0.9692f, 1.0497f, 8.7980f },
+    { 2,  8, 4, 1.0120f, 0.5244f, 5.9787f },
+    { 3,  3, 1, 0.9373f, 1.0799f, 9.9355f },
+    { 3,  4, 2, 0.9240f, -0.2578f, 9.8340f },
+    { 3,  5, 1, 0.8474f, 1.6101f, 14.7032f },
+    { 3,  6, 2, 0.5814f, -1.7169f, 13.5541f },
+    { 3,  7, 1, 0.5426f, 3.9228f, 14.6901f },
+    { 3,  7, 3, 0.6111f, 2.8261f, 13.0256f },
+    { 3,  8, 2, 0.4919f, -1.2398f, 14.3976f },
+    { 3,  8, 4, 0.6284f, -0.9787f, 11.7646f },
+    { 4,  3, 1, 0.7568f, 0.9561f, 5.8319f },
+    { 4,  4, 2, 0.7225f, -0.5687f, 4.3969f },
+    { 4,  5, 1, 0.5306f, 2.9074f, 6.3994f },
+    { 4,  6, 2, 0.6279f, 0.2069f, 6.4601f },
+    { 4,  7, 1, 0.5565f, 3.3281f, 8.5785f },
+    { 4,  7, 3, 0.6824f, 3.2451f, 7.9382f },
+    { 4,  8, 2, 0.6268f, 0.6281f, 8.9376f },
+    { 4,  8, 4, 0.9065f, 1.1399f, 7.6836f },
+    { 5,  3, 1, 1.1279f, -2.6564f, 6.3225f },
+    { 5,  4, 2, 1.1471f, 1.1566f, 4.7741f },
+    { 5,  5, 1, 1.3775f, -5.1744f, 9.1531f },
+    { 5,  6, 2, 1.4447f, 4.2105f, 7.6062f },
+    { 5,  7, 1, 1.6574f, -8.5067f, 12.5562f },
+    { 5,  7, 3, 1.5016f, -4.7261f, 7.2084f },
+    { 5,  8, 2, 1.4364f, 5.6407f, 9.8540f },
+    { 5,  8, 4, 1.2918f, 4.4173f, 6.0991f },
+    { 6,  3, 1, 0.9334f, 0.2754f, 6.2513f },
+    { 6,  4, 2, 0.9367f, -0.3356f, 5.9343f },
+    { 6,  5, 1, 0.8789f, 0.3941f, 9.1872f },
+    { 6,  6, 2, 0.7970f, -0.7596f, 8.8518f },
+    { 6,  7, 1, 0.7755f, 1.2245f, 10.7714f },
+    { 6,  7, 3, 0.8609f, 0.7234f, 8.9594f },
+    { 6,  8, 2, 0.7527f, -0.4108f, 10.2189f },
+    { 6,  8, 4, 0.8674f, -0.0113f, 7.9619f }
+};
+
+
+/**
+ * ProbCut: starts from the built-in parameters. Pairs deeper than the
+ * calibration went have a = 0, which disables them.
+ */
+ProbCut::ProbCut()
+{
+    int stage, deep, k;
+    unsigned int i;
+
+    this->confidence = PC_CONFIDENCE;
+    this->loaded = false;
+    memset(this->pairs, 0, sizeof(this->pairs));
+
+    for(stage = 0; stage < PC_STAGES; stage++)
+    {
+        for(deep = PC_MINDEPTH; deep <= PC_MAXDEPTH; deep++)
+        {
+            for(k = 0; k < PC_TRIES; k++)
+            {
+                this->pairs[stage][deep][k].shallow = shallowDepth(deep, k);
+            }
+        }
+    }
+
+    for(i = 0; i < sizeof(defaults)/sizeof(defaults[0]); i++)
+    {
+        for(k = 0; k < PC_TRIES; k++)
+        {
+            ProbCutPair &pair =
+                this->pairs[defaults[i].stage][defaults[i].deep][k];
+            if(pair.shallow == defaults[i].shallow)
+            {
+                pair.a = defaults[i].a;
+                pair.b = defaults[i].b;
+                pair.sigma = defaults[i].sigma;
+            }
+        }
+    }
+}
+
+/**
+ * stage: which set of parameters applies to `board'.
+ */
+int ProbCut::stage(Board &board)
+{
+    int discs = board.countBlack() + board.countWhite();
+    return (discs - 4) / 10;
+}
+
+/**
+ * shallowDepth: the k-th shallow depth tried for a search to `deep'. The
+ * last one is about half of `deep'; earlier ones are two plies shallower
+ * each. Shallow and deep depths have the same parity, since the heuristic
+ * swings with the side that moved last.
+ *
+ * return: the depth, or 0 if there is no such shallow search.
+ */
+int ProbCut::shallowDepth(int deep, int k)
+{
+    int shallow = deep / 2;
+    if(shallow % 2 != deep % 2)
+    {
+        shallow--;
+    }
+    shallow -= 2 * (PC_TRIES - 1 - k);
+    return (shallow >= 1 ? shallow : 0);
+}
+
+/**
+ * load: reads parameters written by save(). Lines are
+ *
+ *      stage deep shallow a b sigma
+ *
+ * and '#' starts a comment. Pairs not listed keep their current values.
+ *
+ * return: false if the file cannot be read or has a bad line.
+ */
+bool ProbCut::load(const char *file)
+{
+    char line[256];
+    int stage, deep, shallow, k, lineno = 0;
+    float a, b, sigma;
+    FILE *in = fopen(file, "r");
+
+    if(in == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot open %s", file);
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), in))
+    {
+        lineno++;
+        if(line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if(sscanf(line, "%d %d %d %f %f %f", &stage, &deep, &shallow,
+                  &a, &b, &sigma) != 6 ||
+           stage < 0 || stage >= PC_STAGES ||
+           deep < PC_MINDEPTH || deep > PC_MAXDEPTH || sigma < 0)
+        {
+            ERROR(__FILE__, __LINE__, "%s:%d: bad parameters", file, lineno);
+            fclose(in);
+            return false;
+        }
+
+        for(k = 0; k < PC_TRIES; k++)
+        {
+            if(shallowDepth(deep, k) == shallow && shallow)
+            {
+                ProbCutPair &pair = this->pairs[stage][deep][k];
+                pair.shallow = shallow;
+                pair.a = a;
+                pair.b = b;
+                pair.sigma = sigma;
+            }
+        }
+    }
+    fclose(in);
+    this->loaded = true;
+    return true;
+}
+
+/**
+ * save: writes every used pair in the format read by load().
+ */
+bool ProbCut::save(const char *file)
+{
+    int stage, deep, k;
+    FILE *out = fopen(file, "w");
+
+    if(out == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot write %s", file);
+        return false;
+    }
+
+    fprintf(out, "# stage deep shallow a b sigma\n");
+    for(stage = 0; stage < PC_STAGES; stage++)
+    {
+        for(deep = PC_MINDEPTH; deep <= PC_MAXDEPTH; deep++)
+        {
+            for(k = 0; k < PC_TRIES; k++)
+            {
+                ProbCutPair &pair = this->pairs[stage][deep][k];
+                if(pair.shallow)
+                {
+                    fprintf(out, "%d %d %d %.4f %.4f %.4f\n", stage, deep,
+                            pair.shallow, pair.a, pair.b, pair.sigma);
+                }
+            }
+        }
+    }
+    return fclose(out) == 0;
+}
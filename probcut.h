@@ -0,0 +1,52 @@
+#ifndef __PROBCUT_H__
+#define __PROBCUT_H__
+
+#include "common.h"
+#include "board.h"
+
+#define PC_STAGES (7)       // game stages, by number of discs on the board
+#define PC_MINDEPTH (3)     // shallowest search that may be cut
+#define PC_MAXDEPTH (16)    // deepest search with parameters
+#define PC_TRIES (2)        // shallow searches tried per deep search
+#define PC_CONFIDENCE (1.5) // cut when this many sigmas outside the window
+
+using namespace std;
+
+/**
+ * ProbCutPair: the linear model v_deep = a * v_shallow + b for one pair of
+ * search depths, with `sigma' the standard deviation of its error. An entry
+ * with shallow = 0 or a <= 0 is unused.
+ */
+struct ProbCutPair
+{
+    int shallow;
+    float a, b, sigma;
+};
+
+/**
+ * ProbCut: parameters for Multi-ProbCut. For every stage and deep search
+ * depth there are up to PC_TRIES shallow depths, cheapest first, each with
+ * its own regression. The defaults were fitted by `calibrate' (see
+ * calibrate.cpp), which writes files in the format read by load(), to the
+ * classic heuristic; a search evaluating with the network only prunes once
+ * parameters have been loaded.
+ */
+class ProbCut
+{
+public:
+    ProbCut();
+
+    ProbCutPair pairs[PC_STAGES][PC_MAXDEPTH + 1][PC_TRIES];
+    double confidence;
+    bool loaded;        // set by load(), so not just the built-in defaults
+
+    bool load(const char *file);
+    bool save(const char *file);
+
+    static int stage(Board &board);
+    static int shallowDepth(int deep, int k);
+};
+
+extern ProbCut probCut;
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __RANDOM_H__
+#define __RANDOM_H__
+
+#include <stdint.h>
+
+/**
+ * Random: a small xorshift64* generator. Unlike rand() each user has its own
+ * state, so a seeded engine makes the same choices in every run and in any
+ * thread.
+ */
+class Random
+{
+public:
+    Random(uint64_t seed = 1) { this->seed(seed); }
+
+    void seed(uint64_t seed)
+    {
+        this->state = seed ? seed : 0x9E3779B97F4A7C15UL;
+    }
+
+    uint64_t next()
+    {
+        this->state ^= this->state >> 12;
+        this->state ^= this->state << 25;
+        this->state ^= this->state >> 27;
+        return this->state * 0x2545F4914F6CDD1DUL;
+    }
+
+    // Uniform in [0, n)
+    int below(int n) { return (int)(this->next() % (uint64_t)n); }
+
+private:
+    uint64_t state;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include "record.h"
+#include "config.h"
+#include <cstring>
+
+#define RECORD_VERSION (3)
+
+
+GameRecord::GameRecord()
+{
+    this->side = BLACK;
+    this->memory = 0;
+    this->seed = 0;
+    this->deterministic = false;
+    this->fingerprint = 0;
+    this->cache = false;
+    this->out = NULL;
+}
+
+GameRecord::~GameRecord()
+{
+    if(this->out != NULL)
+    {
+        fclose(this->out);
+    }
+}
+
+/**
+ * create: starts writing a record to `file' of a game played with the
+ * settings in `config'. Every move is flushed as it is written, so the
+ * record survives the engine being killed.
+ */
+bool GameRecord::create(const char *file, Side side, uint64_t seed,
+                        bool deterministic, bool cache)
+{
+    this->out = fopen(file, "w");
+    if(this->out == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot write %s", file);
+        return false;
+    }
+
+    this->side = side;
+    this->memory = config.memory;
+    this->seed = seed;
+    this->deterministic = deterministic;
+    this->fingerprint = config.fingerprint();
+    this->cache = cache;
+    config.settings(this->settings);
+    fprintf(this->out, "# othello-record %d side %s memory %lu seed %lu"
+            " deterministic %d fingerprint %lu cache %d\n", RECORD_VERSION,
+            side == BLACK ? "Black" : "White", (unsigned long)this->memory,
+            (unsigned long)seed, deterministic ? 1 : 0,
+            (unsigned long)this->fingerprint, cache ? 1 : 0);
+    for(unsigned int i = 0; i < this->settings.size(); i++)
+    {
+        fprintf(this->out, "# config %s %s\n",
+                this->settings[i].first.c_str(),
+                this->settings[i].second.c_str());
+    }
+    fflush(this->out);
+    return true;
+}
+
+void GameRecord::opponent(int x, int y)
+{
+    if(this->out != NULL)
+    {
+        fprintf(this->out, "O %d %d\n", x, y);
+        fflush(this->out);
+    }
+}
+
+void GameRecord::engine(int x, int y, int score, int depth,
+                        unsigned long nodes, int ms, int msLeft)
+{
+    if(this->out != NULL)
+    {
+        fprintf(this->out, "E %d %d %d %d %lu %d %d\n", x, y, score, depth,
+                nodes, ms, msLeft);
+        fflush(this->out);
+    }
+}
+
+/**
+ * load: reads a record written by create() and friends into `moves'.
+ *
+ * return: false if the file cannot be read or is not a game record.
+ */
+bool GameRecord::load(const char *file)
+{
+    char line[256], sideName[16], name[64];
+    unsigned long memory, seed, fingerprint = 0;
+    int version, deterministic = 1, cache = 0, used, fields;
+    RecordedMove move;
+    FILE *in = fopen(file, "r");
+
+    if(in == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot open %s", file);
+        return false;
+    }
+
+    fields = !fgets(line, sizeof(line), in) ? 0 :
+             sscanf(line, "# othello-record %d side %15s memory %lu seed %lu"
+                    " deterministic %d fingerprint %lu cache %d", &version,
+                    sideName, &memory, &seed, &deterministic, &fingerprint,
+                    &cache);
+    if(fields < 4 || version < 1 || version > RECORD_VERSION ||
+       (version > 1 && fields < 6) || (version > 2 && fields < 7))
+    {
+        ERROR(__FILE__, __LINE__, "%s is not a game record", file);
+        fclose(in);
+        return false;
+    }
+    this->side = strcmp(sideName, "Black") ? WHITE : BLACK;
+    this->memory = memory;
+    this->seed = seed;
+    this->deterministic = deterministic;
+    this->fingerprint = fingerprint;
+    this->cache = cache;
+    this->settings.clear();
+    this->moves.clear();
+
+    while(fgets(line, sizeof(line), in))
+    {
+        memset(&move, 0, sizeof(move));
+        move.msLeft = -1;
+        if(sscanf(line, "# config %63s %n", name, &used) == 1)
+        {
+            string value(line + used);
+            value.erase(value.find_last_not_of(" \t\r\n") + 1);
+            this->settings.push_back(make_pair(string(name), value));
+            continue;
+        }
+        if(sscanf(line, "O %d %d", &move.x, &move.y) == 2)
+        {
+            move.engine = false;
+        }
+        else if(sscanf(line, "E %d %d %d %d %lu %d %d", &move.x, &move.y,
+                       &move.score, &move.depth, &move.nodes, &move.ms,
+                       &move.msLeft) >= 6)
+        {
+            move.engine = true;
+        }
+        else
+        {
+            continue;   // a line cut short by a crash
+        }
+        this->moves.push_back(move);
+    }
+    fclose(in);
+    return true;
+}
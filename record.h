@@ -0,0 +1,74 @@
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+using namespace std;
+
+/**
+ * RecordedMove: one line of a game record. Opponent moves only have a
+ * square; the engine's own moves also carry the statistics of the search
+ * that chose them and the time the engine was given for the rest of the
+ * game (-1 for none). x = y = -1 is a pass (or, for the opponent, the start
+ * of the game).
+ */
+struct RecordedMove
+{
+    bool engine;
+    int x, y;
+    int score, depth;
+    unsigned long nodes;
+    int ms;
+    int msLeft;
+};
+
+/**
+ * GameRecord: a compact text log of one game as seen by the engine, for
+ * replaying against another build (see replay.cpp). The first line is
+ *
+ *      # othello-record 3 side Black memory 750000000 seed 1 deterministic 1
+ *        fingerprint 123 cache 0
+ *
+ * (on one line), the fingerprint being Config::fingerprint() and cache 1 if
+ * the game was played with a shared cache (see cache.h). It is followed by
+ * "# config name value" for every setting in effect (see
+ * Config::settings()), then "O x y" for every move received and
+ * "E x y score depth nodes ms msLeft" for every move played. Records of
+ * version 1 have neither the settings nor the last two fields of the
+ * header, and records before version 3 neither the cache nor msLeft.
+ */
+class GameRecord
+{
+public:
+    GameRecord();
+    ~GameRecord();
+
+    Side side;
+    size_t memory;      // size of the engine's Brain
+    uint64_t seed;
+    bool deterministic;
+    uint64_t fingerprint;                       // 0 if not recorded
+    bool cache;
+    vector< pair<string, string> > settings;    // empty if not recorded
+    vector<RecordedMove> moves;
+
+    bool create(const char *file, Side side, uint64_t seed,
+                bool deterministic, bool cache);
+    void opponent(int x, int y);
+    void engine(int x, int y, int score, int depth, unsigned long nodes,
+                int ms, int msLeft);
+
+    bool load(const char *file);
+
+private:
+    FILE *out;
+
+    GameRecord(const GameRecord &);
+    GameRecord &operator=(const GameRecord &);
+};
+
+#endif
@@ -0,0 +1,508 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "analysis.h"
+#include "board.h"
+#include "search.h"
+#include "threadpool.h"
+using namespace std;
+
+/*
+ * Plays matches between two player programs, A and B, the way the Java
+ * framework's TestGame does but without a JVM in between. Each player is
+ * started as "<command> Black" or "<command> White" through /bin/sh, and
+ * spoken to over pipes in wrapper.cpp's protocol: its first line must be
+ * "Init done", then it is sent "<x> <y> <ms left>" with its opponent's last
+ * move (-1 -1 for none or a pass) every turn and answers "<x> <y>", or
+ * "-1 -1" to pass. Like OthelloGame, passing is only legal without a legal
+ * move, and a player that crashes, answers badly, moves illegally or runs
+ * out of time loses the game.
+ *
+ * --games games are played, --threads at a time, A and B swapping colours
+ * every game. With --time each player has that many ms for the whole game,
+ * kept on the monotonic clock to the microsecond; without it the clock is
+ * not kept and players are sent -1. Players get --init-time ms to start,
+ * run with at most --memory MB of address space if it is given, and have
+ * their stderr thrown away unless --stderr is given. One line is written
+ * per turn, passes included, games in order:
+ *
+ *      <game> start <black: A|B> <white: A|B>
+ *      <game> <ply> <b|w> <move> <latency us> <ms left>
+ *      <game> end <black> <white> <moves>
+ *
+ * the latency being from the request written to the reply read, and the
+ * moves of the end line a transcript annotate reads. A game lost by a
+ * player's fault ends in "<game> error <ply> <b|w> <reason>" instead. A
+ * summary of the results and of each player's latencies goes to stderr.
+ */
+
+#define REFEREE_INITTIME (30000)    // default ms for a player to start
+#define REFEREE_GRACE (1000)        // ms for a player to exit on its own
+#define REFEREE_MAXLINE (1024)      // longest reply taken
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [--games N] [--time MS] [--threads N]"
+         << " [--init-time MS]" << endl
+         << "       [--memory MB] [--stderr] A B" << endl;
+    exit(-1);
+}
+
+/*
+ * The monotonic clock in microseconds.
+ */
+static int64_t nowus() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * A player's results, over the games it played.
+ */
+struct Tally {
+    int wins, losses, draws, forfeits;
+    long discs;                     // own minus the opponent's
+    vector<int64_t> latency;        // us, one per move answered
+};
+
+/*
+ * What the games share with the thread writing the results.
+ */
+struct Referee {
+    string command[2];              // A, B
+    int64_t time;                   // ms per player per game, 0 for none
+    int initTime;
+    size_t memory;                  // bytes of address space, 0 for any
+    bool passStderr;
+
+    pthread_mutex_t lock;
+    pthread_cond_t finished;        // signalled when a game is done
+    map<long, string> results;      // finished games not yet written
+    Tally tally[2];
+};
+
+/*
+ * A running player, spoken to over `in' and heard from over `out'. It
+ * leads a process group of its own, so whatever it starts is stopped
+ * with it.
+ */
+struct Engine {
+    pid_t pid;
+    int in, out;
+    string buffer;                  // read but not yet taken
+};
+
+/*
+ * Starts `command' as the player for `side'. Only async-signal-safe calls
+ * are made between fork() and exec(), other games' threads going on, and
+ * the pipes are closed on exec so no player holds another's open.
+ *
+ * return: false, with a message, if the process cannot be made.
+ */
+static bool startEngine(const Referee &shared, const string &command,
+                        Side side, Engine &engine) {
+    string line = command + (side == BLACK ? " Black" : " White");
+    int in[2], out[2], null = -1;
+    struct rlimit limit;
+
+    if (pipe2(in, O_CLOEXEC) < 0) {
+        ERROR(__FILE__, __LINE__, "cannot make a pipe: %s", strerror(errno));
+        return false;
+    }
+    if (pipe2(out, O_CLOEXEC) < 0) {
+        ERROR(__FILE__, __LINE__, "cannot make a pipe: %s", strerror(errno));
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+    if (!shared.passStderr) null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    limit.rlim_cur = limit.rlim_max = shared.memory;
+
+    engine.pid = fork();
+    if (engine.pid == 0) {
+        setpgid(0, 0);
+        dup2(in[0], 0);
+        dup2(out[1], 1);
+        if (null >= 0) dup2(null, 2);
+        signal(SIGPIPE, SIG_DFL);
+        if (shared.memory) setrlimit(RLIMIT_AS, &limit);
+        execl("/bin/sh", "sh", "-c", line.c_str(), (char *)NULL);
+        _exit(127);
+    }
+    if (engine.pid > 0) setpgid(engine.pid, engine.pid);
+
+    close(in[0]);
+    close(out[1]);
+    if (null >= 0) close(null);
+    if (engine.pid < 0) {
+        ERROR(__FILE__, __LINE__, "cannot fork a player: %s",
+              strerror(errno));
+        close(in[1]);
+        close(out[0]);
+        return false;
+    }
+    engine.in = in[1];
+    engine.out = out[0];
+    engine.buffer.clear();
+    return true;
+}
+
+/*
+ * Stops a player: it is sent end of file and given REFEREE_GRACE ms to
+ * exit, or none if `now', and its process group is then killed.
+ */
+static void stopEngine(Engine &engine, bool now) {
+    int64_t until = nowus() + (now ? 0 : REFEREE_GRACE * 1000);
+    pid_t done;
+
+    if (engine.pid <= 0) return;
+    close(engine.in);
+    close(engine.out);
+    while ((done = waitpid(engine.pid, NULL, WNOHANG)) == 0 &&
+           nowus() < until) {
+        usleep(1000);
+    }
+    kill(-engine.pid, SIGKILL);
+    if (done == 0) waitpid(engine.pid, NULL, 0);
+    engine.pid = -1;
+}
+
+/*
+ * Writes all of `text' to the player.
+ *
+ * return: false if it has closed its input.
+ */
+static bool sendLine(Engine &engine, const string &text) {
+    const char *buf = text.c_str();
+    size_t len = text.size();
+
+    while (len > 0) {
+        ssize_t n = write(engine.in, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+/*
+ * Reads the player's next line into `line', waiting until `deadline' on
+ * nowus()'s clock, or for as long as it takes if that is -1.
+ *
+ * return: false, with the reason in `why', if no line came.
+ */
+static bool readLine(Engine &engine, int64_t deadline, string &line,
+                     string &why) {
+    char buf[256];
+    size_t eol;
+
+    while ((eol = engine.buffer.find('\n')) == string::npos) {
+        int wait = -1;
+        if (engine.buffer.size() > REFEREE_MAXLINE) {
+            why = "sent a line too long";
+            return false;
+        }
+        if (deadline >= 0) {
+            int64_t left = deadline - nowus();
+            if (left <= 0) {
+                why = "ran out of time";
+                return false;
+            }
+            wait = (int)((left + 999) / 1000);
+        }
+
+        struct pollfd p;
+        p.fd = engine.out;
+        p.events = POLLIN;
+        p.revents = 0;
+        int ready = poll(&p, 1, wait);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) continue;
+        ssize_t n = (ready < 0) ? -1 : read(engine.out, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            why = "exited";
+            return false;
+        }
+        engine.buffer.append(buf, n);
+    }
+
+    line = engine.buffer.substr(0, eol);
+    engine.buffer.erase(0, eol + 1);
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+        line.erase(line.size() - 1);
+    }
+    return true;
+}
+
+/*
+ * Plays game `game' (from 0) between A and B, returning its output lines.
+ * The results go into the shared tallies.
+ */
+static string playGame(Referee &shared, long game) {
+    const char *names = "AB";
+    // Players by colour, black first: A is black in even games
+    int player[2] = { (int)(game % 2), (int)(1 - game % 2) };
+    Engine engine[2];
+    vector<int64_t> latency[2];
+    int64_t clock[2] = { shared.time * 1000, shared.time * 1000 };
+    ostringstream out;
+    string reply, why, moves;
+    Board board;
+    Side side = BLACK;
+    int lastX = -1, lastY = -1, ply = 0, loser = -1;
+    long id = game + 1;
+
+    out << id << " start " << names[player[0]] << " " << names[player[1]]
+        << "\n";
+
+    for (int c = 0; c < 2; c++) {
+        if (!startEngine(shared, shared.command[player[c]],
+                         c == 0 ? BLACK : WHITE, engine[c])) {
+            exit(-1);
+        }
+    }
+    int64_t started = nowus();
+    for (int c = 0; c < 2 && loser < 0; c++) {
+        if (!readLine(engine[c], started + (int64_t)shared.initTime * 1000,
+                      reply, why)) {
+            loser = c;
+            why = "did not start: " + why;
+        } else if (reply != "Init done") {
+            loser = c;
+            why = "did not start: sent '" + reply + "'";
+        }
+    }
+
+    while (loser < 0 && !board.isDone()) {
+        int c = (side == BLACK) ? 0 : 1, x, y;
+        char extra, request[64];
+        ply++;
+
+        int64_t left = clock[c] / 1000;
+        snprintf(request, sizeof(request), "%d %d %ld\n", lastX, lastY,
+                 shared.time ? (long)max(left, (int64_t)1) : -1L);
+        int64_t sent = nowus();
+        if (!sendLine(engine[c], request)) {
+            loser = c;
+            why = "exited";
+            break;
+        }
+        if (!readLine(engine[c], shared.time ? sent + clock[c] : -1, reply,
+                      why)) {
+            loser = c;
+            break;
+        }
+        int64_t elapsed = nowus() - sent;
+        if (shared.time && (clock[c] -= elapsed) < 0) {
+            loser = c;
+            why = "ran out of time";
+            break;
+        }
+
+        if (sscanf(reply.c_str(), "%d %d %c", &x, &y, &extra) != 2) {
+            loser = c;
+            why = "sent '" + reply + "'";
+            break;
+        }
+        Move move(x, y);
+        bool pass = (x == -1 && y == -1);
+        if (pass ? board.hasMoves(side)
+                 : (x < 0 || x > 7 || y < 0 || y > 7 ||
+                    !board.checkMove(&move, side))) {
+            loser = c;
+            why = "played '" + reply + "'";
+            break;
+        }
+
+        latency[c].push_back(elapsed);
+        out << id << " " << ply << " " << (side == BLACK ? "b " : "w ")
+            << squareName(pass ? PASS : x + 8 * y) << " " << elapsed << " "
+            << (shared.time ? clock[c] / 1000 : -1) << "\n";
+        if (!pass) {
+            board.doMove(&move, side);
+            moves += squareName(x + 8 * y);
+        }
+        lastX = x;
+        lastY = y;
+        side = enemyof(side);
+    }
+
+    for (int c = 0; c < 2; c++) stopEngine(engine[c], c == loser);
+
+    int black = board.countBlack(), white = board.countWhite();
+    if (loser >= 0) {
+        out << id << " error " << ply << " " << (loser == 0 ? "b " : "w ")
+            << why << "\n";
+    } else {
+        out << id << " end " << black << " " << white << " "
+            << (moves.empty() ? "-" : moves) << "\n";
+    }
+
+    pthread_mutex_lock(&shared.lock);
+    for (int c = 0; c < 2; c++) {
+        Tally &tally = shared.tally[player[c]];
+        int margin = (c == 0) ? black - white : white - black;
+        if (loser >= 0) {
+            (c == loser ? tally.forfeits : tally.wins)++;
+        } else if (margin > 0) {
+            tally.wins++;
+        } else if (margin < 0) {
+            tally.losses++;
+        } else {
+            tally.draws++;
+        }
+        if (loser < 0) tally.discs += margin;
+        tally.latency.insert(tally.latency.end(), latency[c].begin(),
+                             latency[c].end());
+    }
+    pthread_mutex_unlock(&shared.lock);
+    return out.str();
+}
+
+class GameTask : public Task {
+public:
+    GameTask(Referee *shared, long game) : shared(shared), game(game) {}
+
+    void run(int) {
+        string result = playGame(*this->shared, this->game);
+        pthread_mutex_lock(&this->shared->lock);
+        this->shared->results[this->game] = result;
+        pthread_cond_signal(&this->shared->finished);
+        pthread_mutex_unlock(&this->shared->lock);
+    }
+
+private:
+    Referee *shared;
+    long game;
+};
+
+/*
+ * Writes the finished games that are next in order. Called with the lock
+ * held.
+ */
+static void flush(Referee &shared, long &written) {
+    map<long, string>::iterator it;
+    while ((it = shared.results.find(written)) != shared.results.end()) {
+        cout << it->second;
+        shared.results.erase(it);
+        written++;
+    }
+    cout.flush();
+}
+
+/*
+ * One line of the summary for player `name'.
+ */
+static void report(const char *name, Tally &tally) {
+    vector<int64_t> &v = tally.latency;
+    int64_t total = 0;
+    char line[256];
+
+    sort(v.begin(), v.end());
+    for (unsigned int i = 0; i < v.size(); i++) total += v[i];
+    snprintf(line, sizeof(line), "referee: %s %d wins, %d losses, %d draws,"
+             " %d forfeits, discs %+ld; %u moves, ms mean %.3f median %.3f"
+             " 99%% %.3f max %.3f", name, tally.wins, tally.losses,
+             tally.draws, tally.forfeits, tally.discs, (unsigned)v.size(),
+             v.empty() ? 0.0 : total / 1000.0 / v.size(),
+             v.empty() ? 0.0 : v[v.size() / 2] / 1000.0,
+             v.empty() ? 0.0 : v[v.size() * 99 / 100] / 1000.0,
+             v.empty() ? 0.0 : v.back() / 1000.0);
+    cerr << line << endl;
+}
+
+int main(int argc, char *argv[]) {
+    Referee shared;
+    int threads = 1;
+    long games = 2, memory = 0;
+    const char *command[2] = { NULL, NULL };
+
+    shared.time = 0;
+    shared.initTime = REFEREE_INITTIME;
+    shared.passStderr = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+            games = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--time") && i + 1 < argc) {
+            shared.time = atol(argv[++i]);
+            if (shared.time < 1) usage(argv[0]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--init-time") && i + 1 < argc) {
+            shared.initTime = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--memory") && i + 1 < argc) {
+            memory = atol(argv[++i]);
+            if (memory < 1) usage(argv[0]);
+        } else if (!strcmp(argv[i], "--stderr")) {
+            shared.passStderr = true;
+        } else if (argv[i][0] != '-' && command[1] == NULL) {
+            command[command[0] != NULL] = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (command[1] == NULL || games < 1 || threads < 1 ||
+        shared.initTime < 1) {
+        usage(argv[0]);
+    }
+    shared.command[0] = command[0];
+    shared.command[1] = command[1];
+    shared.memory = (size_t)memory * 1000000;
+    for (int p = 0; p < 2; p++) {
+        Tally &tally = shared.tally[p];
+        tally.wins = tally.losses = tally.draws = tally.forfeits = 0;
+        tally.discs = 0;
+    }
+
+    // A player that dies makes our writes fail instead of killing us
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.finished, NULL);
+    int64_t started = nowus();
+    long submitted = 0, written = 0;
+    {
+        ThreadPool pool(threads);
+
+        while (submitted < games) {
+            pthread_mutex_lock(&shared.lock);
+            while (submitted - written >= 2L * threads) {
+                flush(shared, written);
+                if (submitted - written >= 2L * threads) {
+                    pthread_cond_wait(&shared.finished, &shared.lock);
+                }
+            }
+            pthread_mutex_unlock(&shared.lock);
+
+            pool.submit(new GameTask(&shared, submitted++));
+        }
+        pool.wait();
+    }
+    flush(shared, written);
+
+    cerr << "referee: " << written << " games, "
+         << (nowus() - started) / 1000 << " ms" << endl;
+    report("A", shared.tally[0]);
+    report("B", shared.tally[1]);
+
+    pthread_cond_destroy(&shared.finished);
+    pthread_mutex_destroy(&shared.lock);
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "config.h"
+#include "player.h"
+#include "record.h"
+using namespace std;
+
+/*
+ * Replays a game record (see record.h) against this build. Every position in
+ * which the recorded engine moved is searched again by a player with the
+ * recorded settings, seed, tie-breaking and time left, which is then made to
+ * follow the recorded game. Differences in the chosen move and in nodes and
+ * time per move are reported. The exit status is 1 if any move differs.
+ * --memory overrides the recorded tree size. A record whose evaluation
+ * cannot be set up again, its network file missing or changed, is refused.
+ * Only deterministic records (see wrapper.cpp) replay the same on another
+ * machine. The replay never uses a cache, so a record played with one may
+ * differ where the cache answered.
+ */
+static void usage(const char *name) {
+    cerr << "usage: " << name << " RECORD [--memory MB]" << endl;
+    exit(-1);
+}
+
+static double change(double before, double after) {
+    return before > 0 ? 100.0 * (after - before) / before : 0.0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *file = NULL;
+    long memory = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--memory") && i + 1 < argc) {
+            memory = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && file == NULL) {
+            file = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (file == NULL || memory < 0) usage(argv[0]);
+
+    GameRecord record;
+    if (!record.load(file)) return -1;
+
+    for (unsigned int i = 0; i < record.settings.size(); i++) {
+        if (!config.set(record.settings[i].first,
+                        record.settings[i].second)) {
+            cerr << file << ": setting not understood by this build" << endl;
+            return -1;
+        }
+    }
+    if (!config.apply()) {
+        cerr << file << ": cannot set up its evaluator again" << endl;
+        return -1;
+    }
+    if (record.fingerprint && config.fingerprint() != record.fingerprint) {
+        cerr << file << ": recorded with another evaluation (network file"
+             << " changed?)" << endl;
+        return -1;
+    }
+    config.memory = memory ? (size_t)memory * 1000000 : record.memory;
+
+    Brain brain(config.memory);
+    Player player(record.side, &brain);
+    player.cache = NULL;
+    player.deterministic = record.deterministic;
+    if (record.cache) {
+        cerr << file << ": played with a cache, replayed without" << endl;
+    }
+    player.random.seed(record.seed);
+
+    Board board;
+    Side other = enemyof(record.side);
+    int moves = 0, differ = 0;
+    unsigned long oldNodes = 0, newNodes = 0;
+    long oldMs = 0, newMs = 0;
+
+    printf("%4s %6s %6s %10s %10s %7s %7s %7s\n", "ply", "played", "now",
+           "nodes", "now", "change", "ms", "now");
+    for (unsigned int i = 0; i < record.moves.size(); i++) {
+        RecordedMove &recorded = record.moves[i];
+        Move move(recorded.x, recorded.y);
+        Move *played = (recorded.x >= 0) ? &move : NULL;
+
+        if (!recorded.engine) {
+            board.doMove(played, other);
+            continue;
+        }
+
+        player.board = board;
+        Move *now = player.doMove(NULL, recorded.msLeft);
+        bool same = (now == NULL) ? (played == NULL) :
+                    (played != NULL && now->x == move.x && now->y == move.y);
+
+        char was[8], is[8];
+        snprintf(was, sizeof(was), "%d,%d", recorded.x, recorded.y);
+        snprintf(is, sizeof(is), "%d,%d", now ? now->x : -1, now ? now->y : -1);
+        printf("%4u %6s %6s %10lu %10lu %6.1f%% %7d %7d%s\n", i, was, is,
+               recorded.nodes, player.lastNodes,
+               change(recorded.nodes, player.lastNodes),
+               recorded.ms, player.lastMs, same ? "" : "  DIFFERS");
+
+        moves++;
+        differ += !same;
+        oldNodes += recorded.nodes;
+        newNodes += player.lastNodes;
+        oldMs += recorded.ms;
+        newMs += player.lastMs;
+
+        board.doMove(played, record.side);
+    }
+
+    printf("%d moves, %d differ; nodes %lu -> %lu (%+.1f%%), "
+           "ms %ld -> %ld (%+.1f%%)\n", moves, differ, oldNodes, newNodes,
+           change(oldNodes, newNodes), oldMs, newMs, change(oldMs, newMs));
+    return differ ? 1 : 0;
+}
@@ -0,0 +1,503 @@
+#include "search.h"
+#include "cache.h"
+#include "config.h"
+#include "probcut.h"
+#include <algorithm>
+#include <cmath>
+#include <time.h>
+
+
+int64_t nowms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+/*
+ * Order in which to try moves that no principal variation recommends:
+ * corners first, then edges and the centre, squares next to a free corner
+ * last.
+ */
+static const int8_t squarePriority[64] = {
+    9, 1, 7, 6, 6, 7, 1, 9,
+    1, 0, 3, 3, 3, 3, 0, 1,
+    7, 3, 5, 4, 4, 5, 3, 7,
+    6, 3, 4, 4, 4, 4, 3, 6,
+    6, 3, 4, 4, 4, 4, 3, 6,
+    7, 3, 5, 4, 4, 5, 3, 7,
+    1, 0, 3, 3, 3, 3, 0, 1,
+    9, 1, 7, 6, 6, 7, 1, 9
+};
+
+/**
+ * orderMoves: sorts a move list by squarePriority (insertion sort; the lists
+ * are short).
+ */
+static void orderMoves(int list[], int n)
+{
+    int i, j, square;
+    for(i = 1; i < n; i++)
+    {
+        square = list[i];
+        for(j = i; j > 0 && squarePriority[list[j - 1]] <
+                            squarePriority[square]; j--)
+        {
+            list[j] = list[j - 1];
+        }
+        list[j] = square;
+    }
+}
+
+/**
+ * moveToFront: moves `square' to the start of a move list.
+ *
+ * return: false if it is not in the list.
+ */
+static bool moveToFront(int list[], int n, int square)
+{
+    for(int i = 0; i < n; i++)
+    {
+        if(list[i] == square)
+        {
+            list[i] = list[0];
+            list[0] = square;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+Search::Search()
+{
+    this->nodes = 0;
+    this->stopped = false;
+    this->selective = true;
+    this->neural = network.loaded;
+    this->cache = NULL;
+    this->cacheHits = 0;
+    this->deadline = -1;
+    this->pvlen[0] = 0;
+    this->guidelen = 0;
+    this->guideply = 0;
+    this->following = false;
+}
+
+/**
+ * setDeadline: stop searching once nowms() reaches `when' (-1 for never).
+ */
+void Search::setDeadline(int64_t when)
+{
+    this->deadline = when;
+    this->stopped = false;
+}
+
+/**
+ * setGuide: search `line' first on the next call to negamax(). line[0] is
+ * the move at `ply', the ply negamax() will be called with.
+ */
+void Search::setGuide(const int *line, int len, int ply)
+{
+    this->guideply = ply;
+    this->guidelen = 0;
+    for(int i = 0; i < len && i < MAXPLY; i++)
+    {
+        this->guide[this->guidelen++] = line[i];
+    }
+    this->following = (this->guidelen > 0);
+}
+
+/**
+ * evaluate: the static evaluation, polarized for the side to move.
+ */
+int Search::evaluate(Board &board, Side side)
+{
+    if(this->neural)
+    {
+        network.refresh(this->acc[0], board);
+    }
+    return (side == BLACK ? this->evaluateFor<BLACK>(board, 0)
+                          : this->evaluateFor<WHITE>(board, 0));
+}
+
+/*
+ * evaluateFor: the network's score from the accumulator at `ply' if it is
+ * in use, otherwise heuristic(). Past config.nearEnd discs both are the disc
+ * difference.
+ */
+template <Side side>
+int Search::evaluateFor(Board &board, int ply)
+{
+    int score = (this->neural && board.countBlack() + board.countWhite() <=
+                 config.nearEnd) ? network.evaluate(this->acc[ply])
+                                 : board.heuristic();
+    return (side == BLACK ? score : -score);
+}
+
+/**
+ * updatePV: the move `square' at `ply' is the new best; its line is the
+ * move followed by the child's principal variation.
+ */
+void Search::updatePV(int ply, int square)
+{
+    this->pv[ply][ply] = square;
+    for(int i = ply + 1; i < this->pvlen[ply + 1]; i++)
+    {
+        this->pv[ply][i] = this->pv[ply + 1][i];
+    }
+    this->pvlen[ply] = this->pvlen[ply + 1];
+}
+
+/**
+ * negamax: fail-soft principal variation search of `board' to `depth' plies
+ * with `side' to move. The first move gets the full window; the others are
+ * only shown to be no better with a null window, and searched again with
+ * the full window when that proves false.
+ *
+ * return: the score of the position, exact if it lies strictly between
+ * alpha and beta and a bound otherwise. If the deadline passes the search
+ * unwinds and `stopped' is set.
+ */
+int Search::negamax(Board &board, Side side, int depth, int alpha, int beta,
+                    int ply)
+{
+    if(this->neural)
+    {
+        network.refresh(this->acc[ply], board);
+    }
+    return (side == BLACK)
+        ? this->negamaxFor<BLACK>(board, depth, alpha, beta, ply)
+        : this->negamaxFor<WHITE>(board, depth, alpha, beta, ply);
+}
+
+/**
+ * negamaxFor: negamax() with the side to move fixed at compile time, so that
+ * move generation, making moves and evaluation need no tests of colour.
+ */
+template <Side side>
+int Search::negamaxFor(Board &board, int depth, int alpha, int beta, int ply)
+{
+    const Side other = EnemyOf<side>::value;
+    int list[64], n, i, v, best, guided = PASS, cached = PASS;
+    int alphaIn = alpha;
+    uint64_t key = 0, legal, flips;
+    CacheEntry entry;
+
+    this->pvlen[ply] = ply;
+    this->nodes++;
+
+    if(this->deadline >= 0 && !(this->nodes & 1023) &&
+       nowms() >= this->deadline)
+    {
+        this->stopped = true;
+    }
+    if(this->stopped)
+    {
+        return 0;
+    }
+
+    if(depth <= 0 || ply >= MAXPLY - 1)
+    {
+        this->following = false;
+        return this->evaluateFor<side>(board, ply);
+    }
+
+    // Which move of the guide line belongs to this node, if we are on it
+    if(this->following && ply - this->guideply >= this->guidelen)
+    {
+        this->following = false;
+    }
+    if(this->following)
+    {
+        guided = this->guide[ply - this->guideply];
+    }
+
+    // A result remembered from an earlier search may settle the node, or at
+    // least tell which move to try first.
+    if(this->cache != NULL && depth >= CACHE_MINDEPTH)
+    {
+        key = SearchCache::hash(board, side);
+        if(this->cache->probe(key, entry) && !entry.tree)
+        {
+            if(!this->following && entry.depth >= depth &&
+               (this->selective || !entry.selective) &&
+               (entry.bound == CACHE_EXACT ||
+                (entry.bound == CACHE_LOWER && entry.score >= beta) ||
+                (entry.bound == CACHE_UPPER && entry.score <= alpha)))
+            {
+                this->cacheHits++;
+                if(entry.move != CACHE_NOMOVE)
+                {
+                    this->pv[ply][ply] = entry.move;
+                    this->pvlen[ply] = ply + 1;
+                }
+                return entry.score;
+            }
+            cached = entry.move;
+        }
+    }
+
+    // Near the end the heuristic is the disc difference, which the opponent's
+    // stable discs bound from above for the rest of the game.
+    if(this->stability<side>(board, alpha, v))
+    {
+        return v;
+    }
+
+    if(this->selective && !this->following &&
+       this->probcut<side>(board, depth, alpha, beta, ply, v))
+    {
+        return v;
+    }
+
+    legal = board.movesFor<side>();
+    if(!legal)
+    {
+        if(!board.movesFor<other>())  // game over
+        {
+            // Scored by heuristic(), which knows a finished game
+            this->following = false;
+            v = board.heuristic();
+            return (side == BLACK ? v : -v);
+        }
+        if(this->neural)
+        {
+            this->acc[ply + 1] = this->acc[ply];
+        }
+        v = -this->negamaxFor<other>(board, depth - 1, -beta, -alpha,
+                                     ply + 1);
+        this->updatePV(ply, PASS);
+        return v;
+    }
+    for(n = 0; legal; legal &= legal - 1)
+    {
+        list[n++] = __builtin_ctzl(legal);
+    }
+
+    orderMoves(list, n);
+    if(cached >= 0)
+    {
+        moveToFront(list, n, cached);
+    }
+    if(this->following && !moveToFront(list, n, guided))
+    {
+        this->following = false;
+    }
+
+    best = -SEARCH_INF;
+    for(i = 0; i < n; i++)
+    {
+        // Made and unmade on `board' itself, which is left as it was
+        flips = board.flipsFor<side>(list[i]);
+        board.play<side>(list[i], flips);
+        if(this->neural)
+        {
+            network.update<side>(this->acc[ply + 1], this->acc[ply], list[i],
+                                 flips);
+        }
+
+        if(i == 0)
+        {
+            v = -this->negamaxFor<other>(board, depth - 1, -beta, -alpha,
+                                         ply + 1);
+        }
+        else
+        {
+            this->following = false;
+            v = -this->negamaxFor<other>(board, depth - 1, -alpha - 1,
+                                         -alpha, ply + 1);
+            if(v > alpha && v < beta && !this->stopped)
+            {
+                v = -this->negamaxFor<other>(board, depth - 1, -beta, -alpha,
+                                             ply + 1);
+            }
+        }
+        board.undo<side>(list[i], flips);
+        if(this->stopped)
+        {
+            return 0;
+        }
+
+        if(v > best)
+        {
+            best = v;
+            this->updatePV(ply, list[i]);
+            if(v > alpha)
+            {
+                alpha = v;
+                if(alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    if(this->cache != NULL && depth >= CACHE_MINDEPTH)
+    {
+        entry.score = best;
+        entry.depth = depth;
+        entry.bound = (best <= alphaIn) ? CACHE_UPPER :
+                      (best >= beta) ? CACHE_LOWER : CACHE_EXACT;
+        entry.move = this->pv[ply][ply];
+        entry.selective = this->selective;
+        entry.tree = false;
+        this->cache->store(key, entry);
+    }
+    return best;
+}
+
+/**
+ * stability: stability cutoff. Once the board holds more than config.nearEnd
+ * discs every score below this node is a disc difference, and no line of
+ * play can do better than 64 minus twice the opponent's stable discs.
+ *
+ * return: true with `score' set to that bound if it is no better than
+ * alpha, false if the node has to be searched.
+ */
+template <Side side>
+bool Search::stability(Board &board, int alpha, int &score)
+{
+    const Side other = EnemyOf<side>::value;
+    int bound;
+
+    if(board.countBlack() + board.countWhite() <= config.nearEnd)
+    {
+        return false;
+    }
+
+    // Even if every opponent disc were stable the bound would not cut
+    if(64 - 2 * board.count(other) > alpha)
+    {
+        return false;
+    }
+
+    bound = 64 - 2 * __builtin_popcountl(board.stable(other));
+    if(bound <= alpha)
+    {
+        score = bound;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * probcut: Multi-ProbCut. Predicts the result of searching `board' to
+ * `depth' from shallower searches, and gives up on the node when the
+ * prediction lies outside (alpha, beta) with the configured confidence.
+ * The shallow searches are not pruned themselves, since the regressions
+ * were fitted to full-width ones. With the network and only the built-in
+ * parameters, which fit the classic heuristic, nothing is pruned.
+ *
+ * return: true with `score' set to the bound that was passed, false if the
+ * node has to be searched.
+ */
+template <Side side>
+bool Search::probcut(Board &board, int depth, int alpha, int beta, int ply,
+                     int &score)
+{
+    int k, bound, v;
+    bool cut = false;
+
+    if(depth < PC_MINDEPTH || depth > PC_MAXDEPTH ||
+       (this->neural && !probCut.loaded))
+    {
+        return false;
+    }
+
+    int stage = ProbCut::stage(board);
+    this->selective = false;
+    for(k = 0; k < PC_TRIES && !cut && !this->stopped; k++)
+    {
+        ProbCutPair &pair = probCut.pairs[stage][depth][k];
+        if(!pair.shallow || pair.a <= 0)
+        {
+            continue;
+        }
+        double margin = probCut.confidence * pair.sigma;
+
+        // Deep score very likely >= beta?
+        if(beta < SEARCH_INF)
+        {
+            bound = (int)ceil((beta + margin - pair.b) / pair.a);
+            v = this->negamaxFor<side>(board, pair.shallow, bound - 1, bound,
+                                       ply);
+            if(v >= bound && !this->stopped)
+            {
+                score = beta;
+                cut = true;
+                break;
+            }
+        }
+
+        // Deep score very likely <= alpha?
+        if(alpha > -SEARCH_INF && !this->stopped)
+        {
+            bound = (int)floor((alpha - margin - pair.b) / pair.a);
+            v = this->negamaxFor<side>(board, pair.shallow, bound, bound + 1,
+                                       ply);
+            if(v <= bound && !this->stopped)
+            {
+                score = alpha;
+                cut = true;
+            }
+        }
+    }
+    this->selective = true;
+    return cut;
+}
+
+/**
+ * aspirate: searches with a narrow window around `guess', typically the
+ * score of the previous iteration, widening it on the side that failed until
+ * the score falls inside. The window never extends past (floor, ceiling),
+ * the window the caller is actually interested in.
+ *
+ * return: as negamax() with the window (floor, ceiling).
+ */
+int Search::aspirate(Board &board, Side side, int depth, int guess, int floor,
+                     int ceiling, int ply)
+{
+    int lower = ASPIRATION, upper = ASPIRATION;
+    int alpha, beta, v;
+    int line[MAXPLY], len = this->following ? this->guidelen : 0;
+    int base = this->guideply;
+
+    for(int i = 0; i < len; i++)
+    {
+        line[i] = this->guide[i];
+    }
+
+    for(;;)
+    {
+        alpha = max(guess - lower, floor);
+        beta = min(guess + upper, ceiling);
+        if(alpha >= beta)   // the guess is outside (floor, ceiling)
+        {
+            alpha = floor;
+            beta = ceiling;
+        }
+
+        this->setGuide(line, len, base);
+        v = this->negamax(board, side, depth, alpha, beta, ply);
+        if(this->stopped)
+        {
+            return 0;
+        }
+
+        if(v <= alpha && alpha > floor)
+        {
+            lower *= 4;
+        }
+        else if(v >= beta && beta < ceiling)
+        {
+            upper *= 4;
+        }
+        else
+        {
+            return v;
+        }
+    }
+}
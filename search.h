@@ -0,0 +1,84 @@
+#ifndef __SEARCH_H__
+#define __SEARCH_H__
+
+#include "common.h"
+#include "board.h"
+#include "cache.h"
+#include "network.h"
+
+#define SEARCH_INF (30000)
+#define MAXPLY (80)     // 60 moves plus room for passes
+#define PASS (-1)       // square index of a pass in a principal variation
+#define ASPIRATION (4)  // initial half-width of an aspiration window
+
+using namespace std;
+
+/**
+ * nowms: milliseconds on a monotonic clock.
+ */
+int64_t nowms();
+
+/**
+ * Search: depth-first alpha-beta search over Boards, as opposed to the
+ * breadth-first tree that Player builds in its Brain. Scores are from the
+ * point of view of the side to move (negamax), in units of
+ * Board::heuristic(). A pass uses up one ply, just as it takes one level of
+ * the Brain tree.
+ */
+class Search
+{
+public:
+    Search();
+
+    void setDeadline(int64_t when);
+    void setGuide(const int *line, int len, int ply);
+
+    int negamax(Board &board, Side side, int depth, int alpha, int beta,
+                int ply);
+    int aspirate(Board &board, Side side, int depth, int guess, int floor,
+                 int ceiling, int ply);
+    int evaluate(Board &board, Side side);
+
+    // Triangular principal variation table: pv[ply][ply..pvlen[ply]-1] is
+    // the best line found from the node at `ply'.
+    int pv[MAXPLY][MAXPLY];
+    int pvlen[MAXPLY];
+
+    unsigned long nodes;
+    bool stopped;       // the deadline passed; results are meaningless
+    bool selective;     // prune with Multi-ProbCut (see probcut.h)
+    bool neural;        // evaluate with `network' (see network.h)
+
+    SearchCache *cache; // remembered results, or NULL
+    unsigned long cacheHits;
+
+private:
+    int64_t deadline;   // nowms() value to stop at, or -1
+
+    // Principal variation of the previous iteration. While the search is
+    // still on this line its move is tried first, so that the first child
+    // searched with a full window is usually the right one.
+    int guide[MAXPLY];
+    int guidelen;
+    int guideply;       // ply of guide[0]
+    bool following;
+
+    // First layer of the network for the position at each ply, while
+    // `neural' is set
+    Accumulator acc[MAXPLY];
+
+    void updatePV(int ply, int square);
+
+    // The search proper, instantiated once for each side to move
+    template <Side side>
+    int negamaxFor(Board &board, int depth, int alpha, int beta, int ply);
+    template <Side side>
+    int evaluateFor(Board &board, int ply);
+    template <Side side>
+    bool stability(Board &board, int alpha, int &score);
+    template <Side side>
+    bool probcut(Board &board, int depth, int alpha, int beta, int ply,
+                 int &score);
+};
+
+#endif
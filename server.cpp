@@ -0,0 +1,232 @@
+#include "server.h"
+#include <sstream>
+
+
+/**
+ * Server: allocates one Brain per worker thread out of `memory' bytes. This
+ * is the only large allocation; games created later share these brains.
+ * Workers are not pinned to CPUs, so the brains are interleaved over the
+ * NUMA nodes rather than left wherever the main thread first touched them.
+ */
+Server::Server(int threads, size_t memory, SearchCache *cache,
+               int allocFlags)
+{
+    if(threads < 1)
+    {
+        threads = 1;
+    }
+
+    pthread_mutex_init(&this->lock, NULL);
+    this->out = NULL;
+    this->cache = cache;
+
+    for(int i = 0; i < threads; i++)
+    {
+        this->brains.push_back(new Brain(memory/threads, allocFlags));
+    }
+    this->pool = new ThreadPool(threads);
+
+    cerr << "Server: " << threads << " worker(s), "
+         << (memory/threads)/1000000 << " MB of tree each" << endl;
+    cerr << "Server: tree " << describeAlloc(this->brains[0]->tree,
+                                             this->brains[0]->alloc) << endl;
+}
+
+Server::~Server()
+{
+    delete this->pool;  // finishes outstanding moves
+
+    map<string, Game *>::iterator it;
+    for(it = this->games.begin(); it != this->games.end(); it++)
+    {
+        delete it->second->player;
+        delete it->second;
+    }
+    for(unsigned int i = 0; i < this->brains.size(); i++)
+    {
+        delete this->brains[i];
+    }
+    pthread_mutex_destroy(&this->lock);
+}
+
+/**
+ * run: reads commands from `in' until end of file and writes the replies to
+ * `out'. Replies for different games may come back in any order.
+ *
+ * return: 0 once every outstanding move has been answered.
+ */
+int Server::run(istream &in, ostream &out)
+{
+    string line, id, word;
+    Pending move;
+
+    this->out = &out;
+
+    while(getline(in, line))
+    {
+        istringstream fields(line);
+        if(!(fields >> id >> word))
+        {
+            continue;   // blank line
+        }
+
+        if(word == "Black" || word == "White")
+        {
+            this->startGame(id, word == "Black" ? BLACK : WHITE);
+        }
+        else if(word == "end")
+        {
+            this->endGame(id);
+        }
+        else
+        {
+            istringstream args(line);
+            if(!(args >> id >> move.x >> move.y >> move.msLeft))
+            {
+                WARN(__FILE__, __LINE__, "bad command: %s", line.c_str());
+                continue;
+            }
+            this->queueMove(id, move);
+        }
+    }
+
+    this->pool->wait();
+    return 0;
+}
+
+void Server::startGame(const string &id, Side side)
+{
+    pthread_mutex_lock(&this->lock);
+    if(this->games.count(id))
+    {
+        WARN(__FILE__, __LINE__, "game %s already exists", id.c_str());
+    }
+    else
+    {
+        Game *game = new Game;
+        game->player = new Player(side, NULL);
+        game->player->cache = this->cache;
+        game->busy = false;
+        game->closing = false;
+        this->games[id] = game;
+
+        *this->out << id << " Init done" << endl;
+    }
+    pthread_mutex_unlock(&this->lock);
+}
+
+void Server::queueMove(const string &id, Pending move)
+{
+    pthread_mutex_lock(&this->lock);
+    map<string, Game *>::iterator it = this->games.find(id);
+    if(it == this->games.end())
+    {
+        WARN(__FILE__, __LINE__, "no such game: %s", id.c_str());
+    }
+    else
+    {
+        it->second->pending.push_back(move);
+        if(!it->second->busy)
+        {
+            this->dispatch(id, it->second);
+        }
+    }
+    pthread_mutex_unlock(&this->lock);
+}
+
+void Server::endGame(const string &id)
+{
+    pthread_mutex_lock(&this->lock);
+    map<string, Game *>::iterator it = this->games.find(id);
+    if(it != this->games.end())
+    {
+        if(it->second->busy)
+        {
+            it->second->closing = true;   // the worker cleans up
+        }
+        else
+        {
+            delete it->second->player;
+            delete it->second;
+            this->games.erase(it);
+        }
+    }
+    pthread_mutex_unlock(&this->lock);
+}
+
+/**
+ * dispatch: hands the game's next pending move to the pool. Must be called
+ * with `lock' held.
+ */
+void Server::dispatch(const string &id, Game *game)
+{
+    Pending move = game->pending.front();
+    game->pending.pop_front();
+    game->busy = true;
+    this->pool->submit(new MoveTask(this, id, move));
+}
+
+/**
+ * finishMove: reports a worker's move and starts the game's next pending
+ * move, if any.
+ */
+void Server::finishMove(const string &id, Move *move)
+{
+    pthread_mutex_lock(&this->lock);
+    if(move != NULL)
+    {
+        *this->out << id << " " << move->x << " " << move->y << endl;
+    }
+    else
+    {
+        *this->out << id << " -1 -1" << endl;
+    }
+
+    map<string, Game *>::iterator it = this->games.find(id);
+    Game *game = it->second;
+    game->busy = false;
+    if(game->closing)
+    {
+        delete game->player;
+        delete game;
+        this->games.erase(it);
+    }
+    else if(!game->pending.empty())
+    {
+        this->dispatch(id, game);
+    }
+    pthread_mutex_unlock(&this->lock);
+}
+
+
+Server::MoveTask::MoveTask(Server *server, const string &id, Pending move)
+{
+    this->server = server;
+    this->id = id;
+    this->move = move;
+}
+
+/**
+ * run: plays one move of one game with the worker's brain. The game cannot
+ * be touched by anyone else while it is busy, so no lock is held here.
+ */
+void Server::MoveTask::run(int worker)
+{
+    Player *player;
+
+    pthread_mutex_lock(&this->server->lock);
+    player = this->server->games[this->id]->player;
+    pthread_mutex_unlock(&this->server->lock);
+
+    Move opponentsMove(this->move.x, this->move.y);
+    bool passed = this->move.x < 0 || this->move.y < 0;
+
+    // The reply belongs to the player, which finishMove() may delete, so
+    // nothing is touched after it
+    player->brain = this->server->brains[worker];
+    Move *playersMove = player->doMove(passed ? NULL : &opponentsMove,
+                                       this->move.msLeft);
+    player->brain = NULL;
+
+    this->server->finishMove(this->id, playersMove);
+}
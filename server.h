@@ -0,0 +1,82 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "player.h"
+#include "threadpool.h"
+
+using namespace std;
+
+/**
+ * Server: plays many games at once from a single process. Every line of the
+ * protocol is the wrapper protocol (see `wrapper.cpp') prefixed with a game
+ * id:
+ *
+ *      <id> Black|White        start a game        -> <id> Init done
+ *      <id> x y msLeft         opponent's move     -> <id> x y
+ *      <id> end                forget the game
+ *
+ * Moves are scheduled onto a fixed pool of worker threads. Each worker owns
+ * one Brain, and the memory budget is split between the workers, so a game
+ * only costs its Board until it is given a worker for one move. All games
+ * share the search cache, if there is one.
+ */
+class Server
+{
+public:
+    Server(int threads, size_t memory, SearchCache *cache = NULL,
+           int allocFlags = ALLOC_HUGEPAGES | ALLOC_INTERLEAVE);
+    ~Server();
+
+    int run(istream &in, ostream &out);
+
+private:
+    struct Pending
+    {
+        int x, y, msLeft;
+    };
+
+    struct Game
+    {
+        Player *player;
+        bool busy;              // a worker is computing a move for it
+        bool closing;           // `end' arrived while busy
+        deque<Pending> pending; // moves sent before our reply
+    };
+
+    class MoveTask : public Task
+    {
+    public:
+        MoveTask(Server *server, const string &id, Pending move);
+        void run(int worker);
+
+    private:
+        Server *server;
+        string id;
+        Pending move;
+    };
+
+    ThreadPool *pool;
+    vector<Brain *> brains;     // brains[i] belongs to worker i
+    SearchCache *cache;
+
+    map<string, Game *> games;
+    pthread_mutex_t lock;       // guards `games' and `out'
+    ostream *out;
+
+    void startGame(const string &id, Side side);
+    void queueMove(const string &id, Pending move);
+    void endGame(const string &id);
+    void dispatch(const string &id, Game *game);
+    void finishMove(const string &id, Move *move);
+
+    Server(const Server &);
+    Server &operator=(const Server &);
+};
+
+#endif
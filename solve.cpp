@@ -0,0 +1,158 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "search.h"
+#include "solver.h"
+using namespace std;
+
+/*
+ * Solves Othello on a small board from the standard start (see solver.h).
+ * The best line is found by solving each position along it in turn; every
+ * step must agree with the score of the one before, which checks the solver
+ * against itself. --after starts from the position after the given moves,
+ * written as squares ("c3d3c4"). --perft D instead counts the move sequences
+ * D plies deep, to check move generation. Sizes 4, 6, 8 and 10 are built.
+ * 4x4 is solved at once (white wins 11-3) and 6x6 from the start in about
+ * half an hour on one core with a 2000 MB table (white wins 20-16, 6 billion
+ * nodes); 8x8 and 10x10 only from well into the game.
+ */
+static void usage(const char *name) {
+    cerr << "usage: " << name
+         << " [--size 4|6|8|10] [--threads N] [--table MB]"
+         << " [--after MOVES] [--perft D]" << endl;
+    exit(-1);
+}
+
+static string squareName(int n, int square) {
+    char name[8];
+    if (square < 0) return "pass";
+    snprintf(name, sizeof(name), "%c%d", 'a' + square % n, 1 + square / n);
+    return name;
+}
+
+/*
+ * Plays the moves in `line' from the start, passing when a side has no move.
+ *
+ * return: false if a move is malformed or illegal.
+ */
+template <int N>
+static bool playLine(GridBoard<N> &board, Side &side, const char *line) {
+    for (; line[0] && line[1]; line += 2) {
+        int x = line[0] - 'a', y = line[1] - '1', square = x + N * y;
+        if (x < 0 || x >= N || y < 0 || y >= N) return false;
+
+        if (!((side == BLACK) ? board.template movesFor<BLACK>()
+                              : board.template movesFor<WHITE>())) {
+            side = enemyof(side);
+        }
+        if (side == BLACK) {
+            if (!(board.template movesFor<BLACK>() & Geometry<N>::bit(square)))
+                return false;
+            board.template play<BLACK>(square);
+        } else {
+            if (!(board.template movesFor<WHITE>() & Geometry<N>::bit(square)))
+                return false;
+            board.template play<WHITE>(square);
+        }
+        side = enemyof(side);
+    }
+    return line[0] == 0;
+}
+
+template <int N>
+static int run(int threads, size_t table, int depth, const char *after) {
+    GridBoard<N> board;
+    Side side = BLACK;
+
+    if (after != NULL && !playLine(board, side, after)) {
+        cerr << "illegal line: " << after << endl;
+        return -1;
+    }
+
+    if (depth > 0) {
+        for (int d = 1; d <= depth; d++) {
+            int64_t started = nowms();
+            unsigned long count = perft<N>(board, side, d);
+            printf("perft %d: %lu (%ld ms)\n", d, count,
+                   (long)(nowms() - started));
+        }
+        return 0;
+    }
+
+    Solver<N> solver(table);
+    int64_t started = nowms();
+    int move, score = solver.solve(board, side, threads, move);
+    int ms = (int)(nowms() - started);
+    unsigned long nodes = solver.nodes;
+
+    printf("%dx%d: %s %+d with perfect play (%lu nodes, %d ms, %.0f kn/s, "
+           "%d thread(s))\n", N, N, side == BLACK ? "black" : "white", score,
+           nodes, ms,
+           ms ? (double)nodes / ms : 0.0, threads);
+
+    // Follow the best line, re-solving each position
+    int expect = score, errors = 0;
+    printf("line:");
+    for (;;) {
+        int v = solver.solve(board, side, threads, move);
+        if (v != expect) {
+            printf(" [%s: %+d, expected %+d]",
+                   side == BLACK ? "black" : "white", v, expect);
+            errors++;
+        }
+        if (move < 0) {
+            bool over = (side == BLACK) ? !board.template movesFor<WHITE>()
+                                        : !board.template movesFor<BLACK>();
+            if (over) break;
+            printf(" pass");
+        } else {
+            printf(" %s", squareName(N, move).c_str());
+            if (side == BLACK) {
+                board.template play<BLACK>(move);
+            } else {
+                board.template play<WHITE>(move);
+            }
+        }
+        side = enemyof(side);
+        expect = -v;
+    }
+    printf("\nfinal: black %d white %d\n", board.count(BLACK),
+           board.count(WHITE));
+    return errors ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    int size = 6, depth = 0;
+    const char *after = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long table = SOLVE_TTSIZE / 1000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--table") && i + 1 < argc) {
+            table = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--after") && i + 1 < argc) {
+            after = argv[++i];
+        } else if (!strcmp(argv[i], "--perft") && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (threads < 1 || table < 1 || depth < 0) usage(argv[0]);
+
+    size_t bytes = (size_t)table * 1000000;
+    switch (size) {
+    case 4:  return run<4>(threads, bytes, depth, after);
+    case 6:  return run<6>(threads, bytes, depth, after);
+    case 8:  return run<8>(threads, bytes, depth, after);
+    case 10: return run<10>(threads, bytes, depth, after);
+    default: usage(argv[0]);
+    }
+    return 0;
+}
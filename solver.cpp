@@ -0,0 +1,720 @@
+#include "solver.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cstring>
+
+#define SLOT_VALID ((uint64_t)1 << 31)
+#define SIDE_KEY (0x9e3779b97f4a7c15UL)
+
+
+static inline uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdUL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53UL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t mix(uint128 x)
+{
+    return mix((uint64_t)x ^ mix((uint64_t)(x >> 64)));
+}
+
+
+/**
+ * SolveTask: one thread of Solver::solve().
+ */
+template <int N>
+class SolveTask : public Task
+{
+public:
+    SolveTask(Solver<N> *solver, const GridBoard<N> &board, Side side)
+        : board(board)
+    {
+        this->solver = solver;
+        this->side = side;
+    }
+
+    /*
+     * Narrows in on the score with null-window searches (MTD(f)), which the
+     * bounds in the table make cheap to repeat, starting from a draw. Every
+     * score is even (the squares left over go to the winner), so testing
+     * odd values settles each step either way without ties.
+     */
+    void run(int)
+    {
+        typename Solver<N>::Context ctx;
+        int v = 0, beta, move = -1, best = -1;
+        int lower = -N * N, upper = N * N;
+
+        ctx.solver = this->solver;
+        ctx.rootEmpties = this->board.empties();
+        ctx.nodes = 0;
+
+        while(lower < upper && !this->solver->done)
+        {
+            beta = (v == lower) ? v + 1 : v - 1;
+            v = (this->side == BLACK)
+              ? this->solver->template search<BLACK>(ctx, this->board,
+                                                     beta - 1, beta, move)
+              : this->solver->template search<WHITE>(ctx, this->board,
+                                                     beta - 1, beta, move);
+            if(v >= beta)
+            {
+                lower = v;
+                best = move;    // proven to reach the score
+            }
+            else
+            {
+                upper = v;
+                best = (best < 0) ? move : best;
+            }
+        }
+        v = lower;
+
+        pthread_mutex_lock(&this->solver->lock);
+        this->solver->nodes += ctx.nodes;
+        if(!this->solver->done)
+        {
+            this->solver->done = true;
+            this->solver->score = v;
+            this->solver->best = best;
+        }
+        pthread_mutex_unlock(&this->solver->lock);
+    }
+
+private:
+    Solver<N> *solver;
+    GridBoard<N> board;
+    Side side;
+};
+
+
+/**
+ * Solver: allocates a transposition table of at most `bytes' bytes (a power
+ * of two slots) through bigAlloc().
+ */
+template <int N>
+Solver<N>::Solver(size_t bytes)
+{
+    size_t slots = 4;
+    while(slots * 2 * sizeof(Slot) <= bytes)
+    {
+        slots *= 2;
+    }
+
+    this->table = (Slot *)bigAlloc(slots * sizeof(Slot), ALLOC_HUGEPAGES,
+                                   this->alloc);
+    if(this->table == NULL)
+    {
+        ERROR(__FILE__, __LINE__, "cannot allocate the solver's table");
+        slots = 0;
+    }
+    else
+    {
+        memset((void *)this->table, 0, slots * sizeof(Slot));
+    }
+    this->mask = slots ? slots - 1 : 0;
+    memset((void *)this->busy, 0, sizeof(this->busy));
+    this->sharing = false;
+    this->nodes = 0;
+    this->done = false;
+    this->score = 0;
+    this->best = -1;
+    pthread_mutex_init(&this->lock, NULL);
+}
+
+template <int N>
+Solver<N>::~Solver()
+{
+    bigFree(this->table, this->alloc);
+    pthread_mutex_destroy(&this->lock);
+}
+
+/**
+ * solve: the exact score of `board' with `side' to move, searched by
+ * `threads' threads. `move' is set to a best move, or -1 to pass. The table
+ * is kept between calls, so solving the positions along the best line one
+ * after the other costs little more than the first.
+ */
+template <int N>
+int Solver<N>::solve(const Grid &board, Side side, int threads, int &move)
+{
+    ThreadPool pool(threads < 1 ? 1 : threads);
+
+    this->done = false;
+    this->sharing = pool.size() > 1;
+    this->nodes = 0;
+    for(int i = 0; i < pool.size(); i++)
+    {
+        pool.submit(new SolveTask<N>(this, board, side));
+    }
+    pool.wait();
+
+    move = this->best;
+    return this->score;
+}
+
+/**
+ * Symmetries: the eight symmetries of an N x N board as permutations of the
+ * squares. map[t] takes a square to its image under symmetry t, and unmap[t]
+ * takes it back.
+ */
+template <int N>
+struct Symmetries
+{
+    int map[8][N * N], unmap[8][N * N];
+
+    Symmetries()
+    {
+        for(int t = 0; t < 8; t++)
+        {
+            for(int square = 0; square < N * N; square++)
+            {
+                int x = square % N, y = square / N;
+                if(t & 4)
+                {
+                    swap(x, y);
+                }
+                if(t & 1)
+                {
+                    x = N - 1 - x;
+                }
+                if(t & 2)
+                {
+                    y = N - 1 - y;
+                }
+                this->map[t][square] = x + N * y;
+                this->unmap[t][x + N * y] = square;
+            }
+        }
+    }
+};
+
+template <int N>
+static const Symmetries<N> &symmetries()
+{
+    static const Symmetries<N> table;
+    return table;
+}
+
+template <int N>
+static typename Geometry<N>::Bits transform(typename Geometry<N>::Bits b,
+                                            const int *map)
+{
+    typename Geometry<N>::Bits image = 0;
+    for(; b; b &= b - 1)
+    {
+        image |= Geometry<N>::bit(map[lowestBit(b)]);
+    }
+    return image;
+}
+
+/*
+ * neighbours: the squares next to any disc of `b' in one of the eight
+ * directions.
+ */
+template <int N>
+static inline typename Geometry<N>::Bits neighbours(
+    typename Geometry<N>::Bits b)
+{
+    return shiftDir<N, 1>(b) | shiftDir<N, -1>(b) |
+           shiftDir<N, N>(b) | shiftDir<N, -N>(b) |
+           shiftDir<N, N + 1>(b) | shiftDir<N, -N - 1>(b) |
+           shiftDir<N, N - 1>(b) | shiftDir<N, 1 - N>(b);
+}
+
+/*
+ * Quadrants: the four N/2 x N/2 corners of the board as bitboards.
+ */
+template <int N>
+struct Quadrants
+{
+    typename Geometry<N>::Bits mask[4];
+
+    Quadrants()
+    {
+        for(int q = 0; q < 4; q++)
+        {
+            this->mask[q] = 0;
+        }
+        for(int square = 0; square < N * N; square++)
+        {
+            int x = square % N, y = square / N;
+            this->mask[(x >= N / 2) + 2 * (y >= N / 2)] |=
+                Geometry<N>::bit(square);
+        }
+    }
+};
+
+/*
+ * oddRegions: the quadrants of `board' with an odd number of empty squares.
+ * Whoever plays last in a region usually gains by it.
+ */
+template <int N>
+static typename Geometry<N>::Bits oddRegions(const GridBoard<N> &board)
+{
+    static const Quadrants<N> quadrants;
+    typename Geometry<N>::Bits empty, odd = 0;
+
+    empty = Geometry<N>::all() & ~(board.discs(BLACK) | board.discs(WHITE));
+    for(int q = 0; q < 4; q++)
+    {
+        if(bitCount(empty & quadrants.mask[q]) & 1)
+        {
+            odd |= quadrants.mask[q];
+        }
+    }
+    return odd;
+}
+
+/**
+ * key: the table key of `board' with `side' to move. Early in the game,
+ * where there is time for it, positions that are reflections or rotations
+ * of each other share a key: the smallest over all eight images. `t' is set
+ * to the symmetry that gives it (0 for the board as it is).
+ */
+template <int N>
+uint64_t Solver<N>::key(const Grid &board, Side side, int &t)
+{
+    uint64_t salt = (side == BLACK) ? 0 : SIDE_KEY;
+    typename Grid::Bits black = board.discs(BLACK);
+    typename Grid::Bits white = board.discs(WHITE);
+    uint64_t best = mix(black) ^ mix(white + 1) ^ salt, k;
+
+    t = 0;
+    if(board.empties() < SOLVE_SYMMETRY)
+    {
+        return best;
+    }
+    const Symmetries<N> &sym = symmetries<N>();
+    for(int s = 1; s < 8; s++)
+    {
+        k = mix(transform<N>(black, sym.map[s])) ^
+            mix(transform<N>(white, sym.map[s]) + 1) ^ salt;
+        if(k < best)
+        {
+            best = k;
+            t = s;
+        }
+    }
+    return best;
+}
+
+/**
+ * probe: looks `key' up in its bucket of four slots, which share a cache
+ * line. A slot torn by a concurrent store() fails the check and reads as a
+ * miss.
+ */
+template <int N>
+bool Solver<N>::probe(uint64_t key, int &lower, int &upper, int &move)
+{
+    if(!this->table)
+    {
+        return false;
+    }
+    Slot *bucket = &this->table[key & this->mask & ~(uint64_t)3];
+    for(int i = 0; i < 4; i++)
+    {
+        uint64_t data = bucket[i].data;
+        if((bucket[i].check ^ data) == key && (data & SLOT_VALID))
+        {
+            lower = (int)(data & 0xff) - 128;
+            upper = (int)((data >> 8) & 0xff) - 128;
+            move = (int)((data >> 16) & 0xff) - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * store: replaces the slot of the bucket already holding `key', or else the
+ * one with the fewest empty squares, the least work to redo.
+ */
+template <int N>
+void Solver<N>::store(uint64_t key, int empties, int lower, int upper,
+                      int move)
+{
+    if(!this->table)
+    {
+        return;
+    }
+    Slot *bucket = &this->table[key & this->mask & ~(uint64_t)3];
+    uint64_t data = (uint64_t)(lower + 128) | (uint64_t)(upper + 128) << 8 |
+                    (uint64_t)(move + 1) << 16 | (uint64_t)empties << 24 |
+                    SLOT_VALID;
+    int i, depth, shallowest = 0x80;
+    Slot *slot = bucket;
+
+    for(i = 0; i < 4; i++)
+    {
+        uint64_t old = bucket[i].data;
+        if((bucket[i].check ^ old) == key)
+        {
+            slot = &bucket[i];
+            break;
+        }
+        depth = (old & SLOT_VALID) ? (int)((old >> 24) & 0x7f) : -1;
+        if(depth < shallowest)
+        {
+            shallowest = depth;
+            slot = &bucket[i];
+        }
+    }
+    slot->data = data;
+    slot->check = key ^ data;
+}
+
+/**
+ * isBusy: whether another thread may be searching the position of `key'.
+ * Only a hint: two positions can share an entry, and a stale one only
+ * costs a move being tried a little later than it might have been.
+ */
+template <int N>
+bool Solver<N>::isBusy(uint64_t key)
+{
+    return this->busy[key % SOLVE_BUSY] == key;
+}
+
+template <int N>
+void Solver<N>::setBusy(uint64_t key, bool busy)
+{
+    volatile uint64_t &entry = this->busy[key % SOLVE_BUSY];
+    if(busy)
+    {
+        entry = key;
+    }
+    else if(entry == key)
+    {
+        entry = 0;
+    }
+}
+
+/**
+ * final: the score of a finished game for `side'.
+ */
+template <int N>
+template <Side side>
+int Solver<N>::final(const Grid &board)
+{
+    int diff = board.count(side) - board.count(EnemyOf<side>::value);
+    if(diff > 0)
+    {
+        diff += board.empties();
+    }
+    else if(diff < 0)
+    {
+        diff -= board.empties();
+    }
+    return diff;
+}
+
+/**
+ * lastMove: the score for `side' with one empty square left, which whoever
+ * can takes.
+ */
+template <int N>
+template <Side side>
+int Solver<N>::lastMove(const Grid &board, int &move)
+{
+    const Side other = EnemyOf<side>::value;
+    int square = lowestBit(Grid::G::all() &
+                           ~(board.discs(BLACK) | board.discs(WHITE)));
+    Grid child = board;
+
+    move = -1;
+    if(board.template flipsFor<side>(square))
+    {
+        child.template play<side>(square);
+        move = square;
+    }
+    else if(board.template flipsFor<other>(square))
+    {
+        child.template play<other>(square);
+    }
+    return final<side>(child);
+}
+
+/**
+ * search: fail-soft principal variation search to the end of the game.
+ * Moves are tried in the order the table suggests, then fewest replies
+ * first. Near the end, where the table and sorting cost more than they
+ * save, moves are only grouped by the parity of their region, and a little
+ * before that the children are no longer probed for a cutoff.
+ *
+ * return: the score, exact if strictly inside (alpha, beta) and a bound
+ * otherwise; meaningless once `done' is set by another thread.
+ */
+template <int N>
+template <Side side>
+int Solver<N>::search(Context &ctx, Grid &board, int alpha, int beta,
+                      int &move)
+{
+    const Side other = EnemyOf<side>::value;
+    typename Grid::Bits legal;
+    int list[N * N], weight[N * N], later[N * N];
+    uint64_t keys[N * N];
+    int n, i, j, v, best, reply, empties, lower, upper, cached = -1;
+    int clower, cupper, t, deferred;
+    bool share;
+    typename Grid::Bits replies, occupied, odd, tries[3];
+    int alphaIn, betaIn;
+    typename Grid::Bits flips;
+    uint64_t k = 0;
+
+    ctx.nodes++;
+    move = -1;
+    if(this->done)
+    {
+        return 0;
+    }
+
+    empties = board.empties();
+    if(empties == 1)
+    {
+        return lastMove<side>(board, move);
+    }
+
+    legal = board.template movesFor<side>();
+    if(!legal)
+    {
+        if(!board.template movesFor<other>())
+        {
+            return final<side>(board);
+        }
+        return -this->search<other>(ctx, board, -beta, -alpha, reply);
+    }
+    // No line of play can do better than the opponent's stable discs allow
+    // (not at the root, which must always come back with a move)
+    if(empties < ctx.rootEmpties && N * N - 2 * board.count(other) <= alpha)
+    {
+        v = N * N - 2 * bitCount(board.stable(other));
+        if(v <= alpha)
+        {
+            return v;
+        }
+    }
+
+    if(empties < SOLVE_SHALLOW)
+    {
+        // Corners in odd regions first, then the rest of those regions
+        odd = oddRegions<N>(board);
+        tries[0] = legal & odd & Grid::G::corners();
+        tries[1] = legal & odd & ~Grid::G::corners();
+        tries[2] = legal & ~odd;
+        best = -N * N - 1;
+        for(j = 0; j < 3 && alpha < beta; j++)
+        {
+            for(legal = tries[j]; legal; legal &= legal - 1)
+            {
+                i = lowestBit(legal);
+                flips = board.template flipsFor<side>(i);
+                board.template play<side>(i, flips);
+                v = -this->search<other>(ctx, board, -beta, -alpha, reply);
+                board.template undo<side>(i, flips);
+                if(v > best)
+                {
+                    best = v;
+                    move = i;
+                    if(v > alpha && (alpha = v) >= beta)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    // Bounds from the table narrow the window
+    lower = -N * N;
+    upper = N * N;
+    k = key(board, side, t);
+    if(this->probe(k, lower, upper, cached))
+    {
+        if(cached >= 0)
+        {
+            cached = symmetries<N>().unmap[t][cached];
+        }
+        if(cached < 0 && empties == ctx.rootEmpties)
+        {
+            lower = -N * N;
+            upper = N * N;
+        }
+        else if(lower >= beta || lower == upper)
+        {
+            move = cached;
+            return lower;
+        }
+        else if(upper <= alpha)
+        {
+            move = cached;
+            return upper;
+        }
+        alpha = max(alpha, lower);
+        beta = min(beta, upper);
+    }
+    alphaIn = alpha;
+    betaIn = beta;
+
+    for(n = 0; legal; legal &= legal - 1)
+    {
+        i = lowestBit(legal);
+        flips = board.template flipsFor<side>(i);
+        board.template play<side>(i, flips);
+
+        // A child the table already shows to be good enough settles it
+        keys[n] = 0;
+        if(empties >= SOLVE_ETC)
+        {
+            keys[n] = key(board, other, j);
+            if(this->probe(keys[n], clower, cupper, reply) && -cupper >= beta)
+            {
+                board.template undo<side>(i, flips);
+                move = i;
+                return -cupper;
+            }
+        }
+
+        // Fewest replies first, then fewest empty squares next to our discs
+        // (where the opponent's later moves come from)
+        replies = board.template movesFor<other>();
+        occupied = board.discs(BLACK) | board.discs(WHITE);
+        list[n] = i;
+        weight[n] = (i == cached) ? -1000 :
+            (bitCount(replies) + bitCount(replies & Grid::G::corners())) * 2 +
+            bitCount(neighbours<N>(board.discs(side)) & ~occupied) -
+            ((Grid::G::bit(i) & Grid::G::corners()) ? 2 : 0);
+        board.template undo<side>(i, flips);
+        for(j = n++; j > 0 && weight[j - 1] > weight[j]; j--)
+        {
+            swap(weight[j - 1], weight[j]);
+            swap(list[j - 1], list[j]);
+            swap(keys[j - 1], keys[j]);
+        }
+    }
+
+    // While other threads are at work, moves whose positions one of them is
+    // searching wait until the rest are done
+    share = this->sharing && empties >= SOLVE_DEFER;
+    best = -N * N - 1;
+    for(i = 0, deferred = 0; i < n + deferred; i++)
+    {
+        j = (i < n) ? i : later[i - n];
+        if(share && i < n && i > 0 && this->isBusy(keys[j]))
+        {
+            later[deferred++] = j;
+            continue;
+        }
+        if(share)
+        {
+            this->setBusy(keys[j], true);
+        }
+        flips = board.template flipsFor<side>(list[j]);
+        board.template play<side>(list[j], flips);
+        if(i == 0)
+        {
+            v = -this->search<other>(ctx, board, -beta, -alpha, reply);
+        }
+        else
+        {
+            v = -this->search<other>(ctx, board, -alpha - 1, -alpha, reply);
+            if(v > alpha && v < beta)
+            {
+                v = -this->search<other>(ctx, board, -beta, -alpha, reply);
+            }
+        }
+        board.template undo<side>(list[j], flips);
+        if(share)
+        {
+            this->setBusy(keys[j], false);
+        }
+        if(this->done)
+        {
+            return 0;
+        }
+        if(v > best)
+        {
+            best = v;
+            move = list[j];
+            if(v > alpha && (alpha = v) >= beta)
+            {
+                break;
+            }
+        }
+    }
+
+    if(best <= alphaIn)
+    {
+        upper = best;
+    }
+    else if(best >= betaIn)
+    {
+        lower = best;
+    }
+    else
+    {
+        lower = upper = best;
+    }
+    this->store(k, empties, lower, upper,
+                (move < 0) ? move : symmetries<N>().map[t][move]);
+    return best;
+}
+
+
+/*
+ * perftFor: perft() with the side to move fixed at compile time.
+ */
+template <int N, Side side>
+static unsigned long perftFor(const GridBoard<N> &board, int depth)
+{
+    const Side other = EnemyOf<side>::value;
+    typename GridBoard<N>::Bits legal = board.template movesFor<side>();
+    GridBoard<N> child;
+    unsigned long total = 0;
+
+    if(depth == 0)
+    {
+        return 1;
+    }
+    if(!legal)
+    {
+        if(!board.template movesFor<other>())
+        {
+            return 1;
+        }
+        return perftFor<N, other>(board, depth - 1);
+    }
+    if(depth == 1)
+    {
+        return bitCount(legal);
+    }
+    for(; legal; legal &= legal - 1)
+    {
+        child = board;
+        child.template play<side>(lowestBit(legal));
+        total += perftFor<N, other>(child, depth - 1);
+    }
+    return total;
+}
+
+template <int N>
+unsigned long perft(const GridBoard<N> &board, Side side, int depth)
+{
+    return (side == BLACK) ? perftFor<N, BLACK>(board, depth)
+                           : perftFor<N, WHITE>(board, depth);
+}
+
+
+template class Solver<4>;
+template class Solver<6>;
+template class Solver<8>;
+template class Solver<10>;
+
+template unsigned long perft<4>(const GridBoard<4> &, Side, int);
+template unsigned long perft<6>(const GridBoard<6> &, Side, int);
+template unsigned long perft<8>(const GridBoard<8> &, Side, int);
+template unsigned long perft<10>(const GridBoard<10> &, Side, int);
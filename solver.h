@@ -0,0 +1,94 @@
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+#include <pthread.h>
+#include "common.h"
+#include "alloc.h"
+#include "geometry.h"
+
+#define SOLVE_TTSIZE (256000000) // bytes of transposition table
+#define SOLVE_SHALLOW (7)        // empties below which no table or ordering
+#define SOLVE_ETC (10)           // empties from which children are probed
+#define SOLVE_SYMMETRY (20)      // empties from which reflections share entries
+#define SOLVE_DEFER (12)         // empties from which threads share out moves
+#define SOLVE_BUSY (4096)        // positions being searched that are tracked
+
+using namespace std;
+
+/**
+ * Solver: exact search of an N x N board to the end of the game, scored as
+ * the final disc difference with the empty squares going to the winner.
+ *
+ * All threads search the whole game from the same position and share one
+ * lockless transposition table. Work is shared out as in simplified ABDADA:
+ * a thread leaves for later any move whose position another thread is
+ * already searching, and by the time it comes back to it, the result is
+ * usually in the table. The first thread to finish gives the answer, and
+ * since every bound in the table is exact, so does any other.
+ */
+template <int N>
+class Solver
+{
+public:
+    typedef GridBoard<N> Grid;
+
+    Solver(size_t bytes = SOLVE_TTSIZE);
+    ~Solver();
+
+    int solve(const Grid &board, Side side, int threads, int &move);
+
+    unsigned long nodes;    // over all threads, for the last solve()
+
+private:
+    struct Slot
+    {
+        volatile uint64_t check;    // key ^ data
+        volatile uint64_t data;
+    };
+
+    struct Context
+    {
+        Solver *solver;
+        int rootEmpties;
+        unsigned long nodes;
+    };
+
+    Slot *table;
+    uint64_t mask;
+    AllocInfo alloc;
+    volatile uint64_t busy[SOLVE_BUSY];
+    bool sharing;
+
+    volatile bool done;
+    int score, best;
+    pthread_mutex_t lock;
+
+    static uint64_t key(const Grid &board, Side side, int &t);
+    bool probe(uint64_t key, int &lower, int &upper, int &move);
+    void store(uint64_t key, int empties, int lower, int upper, int move);
+    bool isBusy(uint64_t key);
+    void setBusy(uint64_t key, bool busy);
+
+    template <int M> friend class SolveTask;
+
+    template <Side side>
+    static int final(const Grid &board);
+    template <Side side>
+    static int lastMove(const Grid &board, int &move);
+    template <Side side>
+    int search(Context &ctx, Grid &board, int alpha, int beta,
+               int &move);
+
+    Solver(const Solver &);
+    Solver &operator=(const Solver &);
+};
+
+/**
+ * perft: the number of move sequences `depth' plies long from `board', a
+ * pass counting as a ply and a finished game as a single sequence. Used to
+ * check move generation against known counts.
+ */
+template <int N>
+unsigned long perft(const GridBoard<N> &board, Side side, int depth);
+
+#endif
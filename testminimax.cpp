@@ -1,7 +1,252 @@
 #include <cstdio>
+#include <cstring>
 #include "common.h"
 #include "player.h"
 #include "board.h"
+#include "analysis.h"
+#include "search.h"
+#include "cache.h"
+#include "config.h"
+#include "record.h"
+#include "solver.h"
+
+/*
+ * Reports one check of the engine, as "Correct" or "Wrong".
+ *
+ * return: 1 if it failed, for counting.
+ */
+static int check(bool ok, const char *what) {
+    printf("%s: %s\n", ok ? "Correct" : "Wrong", what);
+    return ok ? 0 : 1;
+}
+
+/*
+ * A move that ends the game has a principal variation of just itself, so
+ * the deeper iterations of a multi-PV analysis have no line to follow
+ * after it. The last empty square, a1, is black's only move.
+ */
+static int testOneMovePV() {
+    const char *position =
+        " wwwwwwb" "wwwwwwww" "wwwwwwww" "wwwwwwww"
+        "wwwwwwww" "wwwwwwww" "wwwwwwww" "wwwwwwww";
+    AnalysisLimits limits;
+    AnalysisResult shallow, deep;
+
+    limits.multipv = 0;
+    limits.depth = 1;
+    limits.msTime = -1;
+    limits.selective = false;
+    bool ok = analyzePosition(position, BLACK, limits, shallow);
+    limits.depth = 4;
+    ok = ok && analyzePosition(position, BLACK, limits, deep);
+
+    return check(ok && deep.moves.size() == 1 && deep.moves[0].square == 0 &&
+                 deep.moves[0].pv.size() == 1 &&
+                 deep.moves[0].score == shallow.moves[0].score,
+                 "multi-PV of a move that ends the game");
+}
+
+/*
+ * Plain minimax, every move searched with no bounds, scored the way Search
+ * scores its leaves and finished games.
+ */
+static int minimax(Board &board, Side side, int depth) {
+    int list[64], n, v, best = -SEARCH_INF;
+
+    if (depth <= 0) {
+        v = board.heuristic();
+        return side == BLACK ? v : -v;
+    }
+    n = board.moveList(side, list);
+    if (n == 0) {
+        if (!board.hasMoves(enemyof(side))) {
+            v = board.heuristic();
+            return side == BLACK ? v : -v;
+        }
+        return -minimax(board, enemyof(side), depth - 1);
+    }
+    for (int i = 0; i < n; i++) {
+        Move move(list[i] % 8, list[i] / 8);
+        uint64_t flips = board.doMove(&move, side);
+        v = -minimax(board, enemyof(side), depth - 1);
+        board.undoMove(list[i], flips);
+        if (v > best) best = v;
+    }
+    return best;
+}
+
+/*
+ * Principal variation search, with and without an aspiration window, must
+ * find the minimax score when it does not prune selectively. The
+ * positions are from the start, the middle game and the end game.
+ */
+static int testPVS() {
+    const char *positions[] = {
+        "                           wb      bw                           ",
+        "b-bbwb---bb-wwb--bbwwbwb--bbwwbbbbbbbbwbbbb-bw--wbbbwbwwwwww-bb-",
+        "www-----wwww--w-wwwwww-bwwwwwbbwwbbwbww-b-wwwww-bwwwwbwwwww-b-bb",
+        "-bbb-wb-b-bwwww-bbwbww-wbwwwwwww-wwwbw-wwwwbwbbb-www-b----wwwwww"
+    };
+    Search search;
+    bool ok = true;
+
+    search.selective = false;
+    for (int i = 0; i < 4; i++) {
+        char data[64];
+        Board board;
+        for (int j = 0; j < 64; j++) data[j] = positions[i][j];
+        board.setBoard(data);
+
+        for (int depth = 1; depth <= 5; depth++) {
+            Side side = (depth & 1) ? BLACK : WHITE;
+            int expected = minimax(board, side, depth);
+            search.setGuide(NULL, 0, 0);
+            int pvs = search.negamax(board, side, depth, -SEARCH_INF,
+                                     SEARCH_INF, 0);
+            search.setGuide(NULL, 0, 0);
+            int aspirated = search.aspirate(board, side, depth,
+                                            expected + 7, -SEARCH_INF,
+                                            SEARCH_INF, 0);
+            ok = ok && pvs == expected && aspirated == expected;
+        }
+    }
+    return check(ok, "PVS and aspiration windows against minimax");
+}
+
+/*
+ * An entry stored in the search cache reads back the same, also after the
+ * file is closed and opened again, and no other key finds it, not even
+ * one that shares its bucket.
+ */
+static int testCache() {
+    const char *file = "testminimax.cache";
+    SearchCache cache;
+    CacheEntry entry, read;
+    Board board;
+    uint64_t key = SearchCache::hash(board, BLACK);
+    bool ok;
+
+    remove(file);
+    entry.score = -1234;
+    entry.depth = 9;
+    entry.bound = CACHE_LOWER;
+    entry.move = 37;
+    entry.selective = true;
+    entry.tree = false;
+    ok = cache.open(file, 1000000);
+    if (ok) {
+        cache.store(key, entry);
+        cache.close();
+        ok = cache.open(file, 1000000) && cache.probe(key, read) &&
+             read.score == entry.score && read.depth == entry.depth &&
+             read.bound == entry.bound && read.move == entry.move &&
+             read.selective == entry.selective && read.tree == entry.tree &&
+             !cache.probe(key ^ (uint64_t)1 << 63, read) &&
+             !cache.probe(SearchCache::hash(board, WHITE), read);
+        cache.close();
+    }
+    remove(file);
+    return check(ok, "search cache round trip and other keys");
+}
+
+/*
+ * A deterministic game recorded as the wrapper does reads back move for
+ * move, and a new player replaying it as replay.cpp does chooses every
+ * move the same after searching the same number of nodes.
+ */
+static int testRecord() {
+    const char *file = "testminimax.record";
+    int depth = config.depth;
+    GameRecord record, loaded;
+    Move last(-1, -1), *reply;
+    bool ok;
+
+    config.depth = 4;
+    ok = record.create(file, BLACK, 1, true, false);
+    {
+        Brain blackBrain(10000000, 0), whiteBrain(10000000, 0);
+        Player black(BLACK, &blackBrain), white(WHITE, &whiteBrain);
+        black.deterministic = white.deterministic = true;
+        for (int ply = 0; ply < 12; ply++) {
+            reply = black.doMove(last.x < 0 ? NULL : &last, 60000 - ply);
+            record.opponent(last.x, last.y);
+            record.engine(reply ? reply->x : -1, reply ? reply->y : -1,
+                          black.bestScore, black.lastDepth, black.lastNodes,
+                          black.lastMs, 60000 - ply);
+            last = reply ? *reply : Move(-1, -1);
+            reply = white.doMove(last.x < 0 ? NULL : &last, -1);
+            last = reply ? *reply : Move(-1, -1);
+        }
+    }
+    ok = ok && loaded.load(file) && loaded.side == BLACK &&
+         loaded.deterministic && !loaded.cache && loaded.moves.size() == 24;
+
+    Brain brain(10000000, 0);
+    Player player(BLACK, &brain);
+    player.deterministic = true;
+    Board board;
+    for (unsigned int i = 0; ok && i < loaded.moves.size(); i++) {
+        RecordedMove &recorded = loaded.moves[i];
+        Move move(recorded.x, recorded.y);
+        Move *played = (recorded.x >= 0) ? &move : NULL;
+        if (recorded.engine) {
+            player.board = board;
+            reply = player.doMove(NULL, recorded.msLeft);
+            ok = recorded.msLeft == 60000 - (int)i / 2 &&
+                 (reply == NULL ? played == NULL :
+                  played != NULL && reply->x == move.x &&
+                  reply->y == move.y) &&
+                 player.lastNodes == recorded.nodes;
+        }
+        board.doMove(played, recorded.engine ? BLACK : WHITE);
+    }
+    remove(file);
+    config.depth = depth;
+    return check(ok, "game record replays with the same moves");
+}
+
+/*
+ * Move generation on the grid boards gives the known move counts from the
+ * standard 8x8 start, and the solver the known result of 4x4 Othello:
+ * white wins 11-3, or by 10 with the empty squares.
+ */
+static int testSolver() {
+    const unsigned long counts[] = { 4, 12, 56, 244, 1396, 8200, 55092 };
+    GridBoard<8> start;
+    GridBoard<4> small;
+    bool ok = true;
+    int move;
+
+    for (int depth = 1; depth <= 7; depth++) {
+        ok = ok && perft<8>(start, BLACK, depth) == counts[depth - 1];
+    }
+    Solver<4> solver(1000000);
+    ok = ok && solver.solve(small, BLACK, 1, move) == -10;
+    return check(ok, "perft from the start and the 4x4 solution");
+}
+
+/*
+ * Settings out of range, malformed or unknown are refused and leave the
+ * setting as it was; those in range take effect.
+ */
+static int testConfig() {
+    Config settings;
+    int depth = settings.depth;
+    bool ok = !settings.set("depth", "0") &&
+              !settings.set("depth", "61") &&
+              !settings.set("depth", "7x") && settings.depth == depth &&
+              settings.set("depth", "60") && settings.depth == 60 &&
+              !settings.set("memory", "0") && !settings.set("threads", "0") &&
+              settings.set("workers", "0") && !settings.set("near-end", "3") &&
+              !settings.set("corner", "101") &&
+              settings.set("corner", "-100") &&
+              !settings.set("time", "sometimes") &&
+              settings.set("time", "none") && !settings.shareClock(true) &&
+              !settings.set("evaluator", "random") &&
+              !settings.set("search-depth", "8") &&
+              settings.set("memory", "30") && settings.memory == 30000000;
+    return check(ok, "configuration range checks");
+}
 
 // Use this file to test your minimax implementation (2-ply depth, with a
 // heuristic of the difference in number of pieces).
@@ -38,7 +283,7 @@ int main(int argc, char *argv[]) {
     Move *move = player->doMove(NULL, 0);
 
     if (move != NULL && move->x == 1 && move->y == 1) {
-        printf("Correct move: (1, 1)");
+        printf("Correct move: (1, 1)\n");
     } else {
         printf("Wrong move: got ");
         if (move == NULL) {
@@ -49,5 +294,13 @@ int main(int argc, char *argv[]) {
         printf(", expected (1, 1)\n");
     }
 
-    return 0;
+    // The engine's own features, each counted as a failure if wrong
+    int wrong = 0;
+    wrong += testOneMovePV();
+    wrong += testPVS();
+    wrong += testCache();
+    wrong += testRecord();
+    wrong += testSolver();
+    wrong += testConfig();
+    return wrong;
 }
@@ -0,0 +1,123 @@
+#include "threadpool.h"
+#include "error.hpp"
+#include <cstdlib>
+
+
+/**
+ * ThreadPool: starts `nthreads' workers (at least one). Callers size their
+ * work to the pool (one brain per worker, say), so a worker that cannot be
+ * started is fatal rather than quietly leaving the pool short.
+ */
+ThreadPool::ThreadPool(int nthreads)
+{
+    pthread_mutex_init(&this->lock, NULL);
+    pthread_cond_init(&this->ready, NULL);
+    pthread_cond_init(&this->idle, NULL);
+    this->running = 0;
+    this->stopping = false;
+
+    if(nthreads < 1)
+    {
+        nthreads = 1;
+    }
+
+    for(int i = 0; i < nthreads; i++)
+    {
+        pthread_t thread;
+        Start *start = new Start;
+        start->pool = this;
+        start->worker = i;
+
+        if(pthread_create(&thread, NULL, ThreadPool::enter, start))
+        {
+            ERROR(__FILE__, __LINE__, "could not start worker %d", i);
+            exit(-1);
+        }
+        this->threads.push_back(thread);
+    }
+}
+
+/**
+ * ~ThreadPool: finishes every queued task, then joins the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+    this->wait();
+
+    pthread_mutex_lock(&this->lock);
+    this->stopping = true;
+    pthread_cond_broadcast(&this->ready);
+    pthread_mutex_unlock(&this->lock);
+
+    for(unsigned int i = 0; i < this->threads.size(); i++)
+    {
+        pthread_join(this->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&this->idle);
+    pthread_cond_destroy(&this->ready);
+    pthread_mutex_destroy(&this->lock);
+}
+
+void ThreadPool::submit(Task *task)
+{
+    pthread_mutex_lock(&this->lock);
+    this->queue.push_back(task);
+    pthread_cond_signal(&this->ready);
+    pthread_mutex_unlock(&this->lock);
+}
+
+/**
+ * wait: blocks until the queue is empty and no task is running.
+ */
+void ThreadPool::wait()
+{
+    pthread_mutex_lock(&this->lock);
+    while(!this->queue.empty() || this->running)
+    {
+        pthread_cond_wait(&this->idle, &this->lock);
+    }
+    pthread_mutex_unlock(&this->lock);
+}
+
+void *ThreadPool::enter(void *arg)
+{
+    Start *start = (Start *)arg;
+    ThreadPool *pool = start->pool;
+    int worker = start->worker;
+    delete start;
+
+    pool->loop(worker);
+    return NULL;
+}
+
+void ThreadPool::loop(int worker)
+{
+    Task *task;
+
+    pthread_mutex_lock(&this->lock);
+    for(;;)
+    {
+        while(this->queue.empty() && !this->stopping)
+        {
+            pthread_cond_wait(&this->ready, &this->lock);
+        }
+        if(this->queue.empty())
+        {
+            break;  // stopping and nothing left to do
+        }
+
+        task = this->queue.front();
+        this->queue.pop_front();
+        this->running++;
+        pthread_mutex_unlock(&this->lock);
+
+        task->run(worker);
+        delete task;
+
+        pthread_mutex_lock(&this->lock);
+        this->running--;
+        pthread_cond_broadcast(&this->idle);
+    }
+    pthread_mutex_unlock(&this->lock);
+}
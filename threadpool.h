@@ -0,0 +1,61 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Task: a unit of work for the ThreadPool. run() is given the index of the
+ * worker thread executing it so that tasks may use per-worker resources (for
+ * instance a Brain). The pool deletes the task once run() returns.
+ */
+class Task
+{
+public:
+    virtual ~Task() {}
+    virtual void run(int worker) = 0;
+};
+
+/**
+ * ThreadPool: a fixed set of worker threads pulling tasks from one FIFO
+ * queue.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(int nthreads);
+    ~ThreadPool();
+
+    void submit(Task *task);
+    void wait();
+
+    int size() { return (int)this->threads.size(); }
+
+private:
+    vector<pthread_t> threads;
+    deque<Task *> queue;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;       // signalled when a task is queued
+    pthread_cond_t idle;        // signalled when a task completes
+
+    int running;
+    bool stopping;
+
+    struct Start
+    {
+        ThreadPool *pool;
+        int worker;
+    };
+
+    static void *enter(void *arg);
+    void loop(int worker);
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+};
+
+#endif
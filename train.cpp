@@ -0,0 +1,305 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "board.h"
+#include "config.h"
+#include "network.h"
+#include "random.h"
+#include "search.h"
+using namespace std;
+
+/*
+ * Trains the network evaluator (see network.h) on self-play games. Each
+ * game opens with --opening random moves and goes on with searches of
+ * --depth plies by the classic heuristic, one move in ten still random.
+ * Every position with at most config.nearEnd discs is labelled with the
+ * final disc difference of its game. A float copy of the network is then
+ * fitted by stochastic gradient descent, each position seen under a random
+ * one of the board's eight symmetries, and quantized into --out in the
+ * format of Network::load(). One game in ten is held out, and the fit on
+ * those is reported next to that of the heuristic, scaled by least squares.
+ */
+
+#define RANDOMMOVES (10)    // after the opening, one move in this many is
+                            // random
+
+struct Sample {
+    Board board;
+    float target;           // final disc difference for black / NN_SCALE
+};
+
+/*
+ * The network in floating point, with the same shape and activations.
+ */
+struct FloatNetwork {
+    float input[NN_INPUTS][NN_HIDDEN];
+    float bias[NN_HIDDEN];
+    float dense[NN_DENSE][NN_HIDDEN];
+    float denseBias[NN_DENSE];
+    float output[NN_DENSE];
+    float outputBias;
+};
+
+static FloatNetwork net;
+static int symmetry[8][64];
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [--games N] [--depth D] [--opening N]"
+         << " [--epochs N] [--rate R] [--seed S] [--out FILE]" << endl;
+    exit(-1);
+}
+
+static float uniform(Random &random, float range) {
+    return range * (2.0f * (random.next() >> 11) / 9007199254740992.0f - 1);
+}
+
+static float clamp01(float x) {
+    return x < 0 ? 0 : x > 1 ? 1 : x;
+}
+
+static float clamp(float x, float limit) {
+    return x < -limit ? -limit : x > limit ? limit : x;
+}
+
+/*
+ * Plays one game and appends its positions to `samples'.
+ */
+static void selfPlay(Search &search, Random &random, int depth, int opening,
+                     vector<Sample> &samples) {
+    Board board;
+    Side side = BLACK;
+    unsigned int first = samples.size();
+    int list[64], n, square;
+
+    for (int ply = 0; ; ply++) {
+        n = board.moveList(side, list);
+        if (!n) {
+            if (!board.hasMoves(enemyof(side))) break;
+            side = enemyof(side);
+            continue;
+        }
+
+        if (board.countBlack() + board.countWhite() <= config.nearEnd) {
+            Sample sample;
+            sample.board = board;
+            samples.push_back(sample);
+        }
+
+        square = list[random.below(n)];
+        if (ply >= opening && random.below(RANDOMMOVES)) {
+            search.negamax(board, side, depth, -SEARCH_INF, SEARCH_INF, 0);
+            if (search.pvlen[0] > 0) square = search.pv[0][0];
+        }
+        Move move(square % 8, square / 8);
+        board.doMove(&move, side);
+        side = enemyof(side);
+    }
+
+    int diff = board.countBlack() - board.countWhite();
+    int empties = board.empties();
+    diff += (diff > 0) ? empties : (diff < 0) ? -empties : 0;
+    for (unsigned int i = first; i < samples.size(); i++) {
+        samples[i].target = (float)diff / NN_SCALE;
+    }
+}
+
+/*
+ * The features of `board' under symmetry `t'.
+ */
+static int features(Board &board, int t, int list[]) {
+    int n = 0;
+    for (uint64_t b = board.discs(BLACK); b; b &= b - 1) {
+        list[n++] = feature(BLACK, symmetry[t][__builtin_ctzl(b)]);
+    }
+    for (uint64_t b = board.discs(WHITE); b; b &= b - 1) {
+        list[n++] = feature(WHITE, symmetry[t][__builtin_ctzl(b)]);
+    }
+    return n;
+}
+
+/*
+ * One step of gradient descent on a sample's squared error.
+ *
+ * return: the network's output before the step.
+ */
+static float step(const int list[], int n, float target, float rate) {
+    float hidden[NN_HIDDEN], second[NN_DENSE], dsecond[NN_DENSE];
+    float dhidden[NN_HIDDEN], y, dy;
+    int i, j, k;
+
+    for (j = 0; j < NN_HIDDEN; j++) hidden[j] = net.bias[j];
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < NN_HIDDEN; j++) hidden[j] += net.input[list[i]][j];
+    }
+    y = net.outputBias;
+    for (k = 0; k < NN_DENSE; k++) {
+        float s = net.denseBias[k];
+        for (j = 0; j < NN_HIDDEN; j++) {
+            s += net.dense[k][j] * clamp01(hidden[j]);
+        }
+        second[k] = s;
+        y += net.output[k] * clamp01(s);
+    }
+
+    dy = y - target;
+    for (k = 0; k < NN_DENSE; k++) {
+        dsecond[k] = (second[k] > 0 && second[k] < 1) ? dy * net.output[k]
+                                                      : 0;
+        net.output[k] = clamp(net.output[k] - rate * dy * clamp01(second[k]),
+                              8);
+    }
+    net.outputBias -= rate * dy;
+
+    for (j = 0; j < NN_HIDDEN; j++) dhidden[j] = 0;
+    for (k = 0; k < NN_DENSE; k++) {
+        if (dsecond[k] == 0) continue;
+        for (j = 0; j < NN_HIDDEN; j++) {
+            dhidden[j] += dsecond[k] * net.dense[k][j];
+            net.dense[k][j] = clamp(net.dense[k][j] -
+                                    rate * dsecond[k] * clamp01(hidden[j]), 8);
+        }
+        net.denseBias[k] -= rate * dsecond[k];
+    }
+
+    for (j = 0; j < NN_HIDDEN; j++) {
+        if (hidden[j] <= 0 || hidden[j] >= 1) dhidden[j] = 0;
+        net.bias[j] -= rate * dhidden[j];
+    }
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < NN_HIDDEN; j++) {
+            // Small enough that 64 discs cannot overflow the accumulator
+            net.input[list[i]][j] = clamp(net.input[list[i]][j] -
+                                          rate * dhidden[j], 2);
+        }
+    }
+    return y;
+}
+
+static void quantize(Network &out) {
+    int i, j;
+    for (i = 0; i < NN_INPUTS; i++) {
+        for (j = 0; j < NN_HIDDEN; j++) {
+            out.input[i][j] = (int16_t)lrintf(net.input[i][j] * NN_ONE);
+        }
+    }
+    for (j = 0; j < NN_HIDDEN; j++) {
+        out.bias[j] = (int16_t)lrintf(net.bias[j] * NN_ONE);
+    }
+    for (i = 0; i < NN_DENSE; i++) {
+        for (j = 0; j < NN_HIDDEN; j++) {
+            out.dense[i][j] = (int16_t)lrintf(net.dense[i][j] * NN_WEIGHT);
+        }
+        out.denseBias[i] = lrintf(net.denseBias[i] * NN_ONE * NN_WEIGHT);
+        out.output[i] = (int16_t)lrintf(net.output[i] * NN_WEIGHT);
+    }
+    out.outputBias = lrintf(net.outputBias * NN_ONE * NN_WEIGHT);
+}
+
+int main(int argc, char *argv[]) {
+    int games = 2000, depth = 4, opening = 8, epochs = 10, seed = 1;
+    float rate = 0.005f;
+    const char *out = "network.txt";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+            games = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--opening") && i + 1 < argc) {
+            opening = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--epochs") && i + 1 < argc) {
+            epochs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (games < 10 || depth < 1 || opening < 0 || epochs < 1 || rate <= 0) {
+        usage(argv[0]);
+    }
+
+    Random random(seed);
+    for (int t = 0; t < 8; t++) {
+        for (int square = 0; square < 64; square++) {
+            int x = square % 8, y = square / 8, swap = x;
+            if (t & 4) { x = y; y = swap; }
+            if (t & 1) x = 7 - x;
+            if (t & 2) y = 7 - y;
+            symmetry[t][square] = x + 8 * y;
+        }
+    }
+
+    // Self-play, the classic heuristic choosing the moves
+    vector<Sample> train, test;
+    Search search;
+    search.neural = false;
+    int64_t started = nowms();
+    for (int g = 0; g < games; g++) {
+        selfPlay(search, random, depth, opening, (g % 10) ? train : test);
+        if ((g + 1) % 100 == 0) {
+            cerr << g + 1 << " games, " << train.size() + test.size()
+                 << " positions, " << (nowms() - started) / 1000 << " s"
+                 << endl;
+        }
+    }
+
+    for (int i = 0; i < NN_INPUTS; i++) {
+        for (int j = 0; j < NN_HIDDEN; j++) {
+            net.input[i][j] = uniform(random, 0.1f);
+        }
+    }
+    for (int j = 0; j < NN_HIDDEN; j++) net.bias[j] = 0.5f;
+    for (int k = 0; k < NN_DENSE; k++) {
+        for (int j = 0; j < NN_HIDDEN; j++) {
+            net.dense[k][j] = uniform(random, 0.25f);
+        }
+        net.denseBias[k] = 0.5f;
+        net.output[k] = uniform(random, 0.25f);
+    }
+    net.outputBias = 0;
+
+    int list[64], n;
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        double error = 0;
+        for (unsigned int i = 0; i < train.size(); i++) {
+            Sample &sample = train[random.below(train.size())];
+            n = features(sample.board, random.below(8), list);
+            float y = step(list, n, sample.target, rate);
+            error += (y - sample.target) * (y - sample.target);
+        }
+        cerr << "epoch " << epoch + 1 << ": rms error "
+             << sqrt(error / train.size()) * NN_SCALE << " discs" << endl;
+        rate *= 0.8f;
+    }
+
+    // Held-out games: the quantized network, and the heuristic fitted as
+    // a * h + b
+    Network quantized;
+    quantize(quantized);
+    double sh = 0, st = 0, shh = 0, sht = 0, errNet = 0, errClassic = 0;
+    for (unsigned int i = 0; i < test.size(); i++) {
+        double h = test[i].board.heuristic(), t = test[i].target * NN_SCALE;
+        double e = quantized.evaluate(test[i].board) - t;
+        sh += h; st += t; shh += h * h; sht += h * t;
+        errNet += e * e;
+    }
+    double m = test.size();
+    double a = (m * sht - sh * st) / (m * shh - sh * sh), b = (st - a * sh) / m;
+    for (unsigned int i = 0; i < test.size(); i++) {
+        double e = a * test[i].board.heuristic() + b -
+                   test[i].target * NN_SCALE;
+        errClassic += e * e;
+    }
+    cerr << test.size() << " held-out positions: rms error "
+         << sqrt(errNet / m) << " discs for the network, "
+         << sqrt(errClassic / m) << " for the heuristic" << endl;
+
+    return quantized.save(out) ? 0 : -1;
+}
@@ -1,19 +1,141 @@
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include "config.h"
 #include "player.h"
+#include "record.h"
+#include "server.h"
 using namespace std;
 
+static void usage(const char *name) {
+    cerr << "usage: " << name << " side [--config FILE] [--SETTING VALUE]..."
+         << " [--no-hugepages]" << endl
+         << "       [--cache FILE] [--deterministic] [--seed N]"
+         << " [--record FILE] [--mcts]" << endl;
+    cerr << "       " << name
+         << " --server [--config FILE] [--SETTING VALUE]... [--no-hugepages]"
+         << endl
+         << "       [--cache FILE]" << endl;
+    cerr << "settings (see config.h): memory, cache-size, threads, workers,"
+         << " depth, time," << endl
+         << "       move-time, playouts, near-end, evaluator, network, win,"
+         << " corner," << endl
+         << "       adjacent-corner, edge, stable" << endl;
+    exit(-1);
+}
+
+/*
+ * The engine's settings (see config.h) come from --config files and
+ * --SETTING VALUE options, in the order given, and are logged to stderr
+ * before the game starts. With --server many games are served over
+ * stdin/stdout (see server.h) by `threads' workers. `memory' is the budget
+ * for the game tree(s), which go on huge pages where the system allows
+ * unless --no-hugepages is given. --cache keeps search results in a file
+ * shared by every game and process using it (see cache.h), made
+ * `cache-size' big if it is new. --deterministic breaks ties between moves
+ * the same way every time and keeps moves off the clock, limited by depth,
+ * memory and playouts alone, --seed seeds the random choices, and --record
+ * logs the game for replay (see record.h). --mcts plays by Monte Carlo
+ * tree search (see mcts.h) on `threads' threads, with `playouts' per move
+ * at most, and `memory' is then the size of its node pool. `workers'
+ * splits the minimax search over that many worker processes (see
+ * cluster.h), each with a tree of `memory'.
+ */
 int main(int argc, char *argv[]) {    
+    bool serve = false;
+    const char *sideName = NULL, *cacheFile = NULL, *recordFile = NULL;
+    bool deterministic = false, hugepages = true, monteCarlo = false;
+    unsigned long seed = time(NULL);
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--server")) {
+            serve = true;
+        } else if (!strcmp(argv[i], "--config") && i + 1 < argc) {
+            if (!config.load(argv[++i])) exit(-1);
+        } else if (!strcmp(argv[i], "--no-hugepages")) {
+            hugepages = false;
+        } else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+            cacheFile = argv[++i];
+        } else if (!strcmp(argv[i], "--deterministic")) {
+            deterministic = true;
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (!strcmp(argv[i], "--mcts")) {
+            monteCarlo = true;
+        } else if (!strncmp(argv[i], "--", 2) && config.has(argv[i] + 2) &&
+                   i + 1 < argc) {
+            if (!config.set(argv[i] + 2, argv[i + 1])) exit(-1);
+            i++;
+        } else if (argv[i][0] != '-' && sideName == NULL) {
+            sideName = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    // Records are replayed by the single-process minimax engine, so they are
+    // not kept for Monte Carlo or distributed games
+    if (serve == (sideName != NULL) ||
+        (monteCarlo && (serve || recordFile != NULL)) ||
+        (config.workers && (serve || monteCarlo || recordFile != NULL))) {
+        usage(argv[0]);
+    }
+    if (!config.apply()) exit(-1);
+    config.log(cerr);
+
+    SearchCache cache, *shared = NULL;
+    if (cacheFile != NULL) {
+        if (!cache.open(cacheFile, config.cacheSize)) exit(-1);
+        shared = &cache;
+    }
+
+    if (serve) {
+        Server server(config.threads, config.memory, shared,
+                      hugepages ? ALLOC_HUGEPAGES | ALLOC_INTERLEAVE
+                                : ALLOC_INTERLEAVE);
+        return server.run(cin, cout);
+    }
+
     // Read in side the player is on.
-    if (argc != 2)  {
-        cerr << "usage: " << argv[0] << " side" << endl;
-        exit(-1);
+    Side side = (!strcmp(sideName, "Black")) ? BLACK : WHITE;
+
+    // Initialize player, with the memory going to whichever tree it uses.
+    // Workers are forked first, before anything else is allocated.
+    Brain *brain = NULL;
+    MonteCarlo *mcts = NULL;
+    Cluster *cluster = NULL;
+    if (config.workers) {
+        cluster = new Cluster(config.workers, config.memory,
+                              hugepages ? ALLOC_HUGEPAGES : 0);
+        cerr << "Cluster: " << config.workers << " worker(s), "
+             << config.memory / 1000000 << " MB of tree each" << endl;
+    } else if (monteCarlo) {
+        // Every thread walks the whole tree, so it is spread over the nodes
+        mcts = new MonteCarlo(config.memory,
+                              hugepages ? ALLOC_HUGEPAGES | ALLOC_INTERLEAVE
+                                        : ALLOC_INTERLEAVE);
+        mcts->threads = config.threads;
+        mcts->limit = config.playouts;
+        cerr << "Tree: " << describeAlloc(mcts->pool, mcts->alloc) << endl;
+    } else {
+        brain = new Brain(config.memory, hugepages ? ALLOC_HUGEPAGES : 0);
+        cerr << "Tree: " << describeAlloc(brain->tree, brain->alloc) << endl;
     }
-    Side side = (!strcmp(argv[1], "Black")) ? BLACK : WHITE;
+    Player *player = new Player(side, brain);
+    player->mcts = mcts;
+    player->cluster = cluster;
+    player->cache = shared;
+    player->deterministic = deterministic;
+    player->random.seed(seed);
 
-    // Initialize player.
-    Player *player = new Player(side);
+    GameRecord record;
+    if (recordFile != NULL &&
+        !record.create(recordFile, side, seed, deterministic,
+                       shared != NULL)) {
+        exit(-1);
+    }
 
     // Tell java wrapper that we are done initializing.
     cout << "Init done" << endl;
@@ -23,25 +145,31 @@ int main(int argc, char *argv[]) {
 
     // Get opponent's move and time left for player each turn.
     while (cin >> moveX >> moveY >> msLeft) {
-        Move *opponentsMove = NULL;
-        if (moveX >= 0 && moveY >= 0) {
-            opponentsMove = new Move(moveX, moveY);
-        }
+        Move opponentsMove(moveX, moveY);
+        bool passed = moveX < 0 || moveY < 0;
         
-        // Get player's move and output to java wrapper.
-        Move *playersMove = player->doMove(opponentsMove, msLeft);                        
+        // Get player's move and output to java wrapper. It is the player's
+        // own, so neither move is allocated.
+        Move *playersMove = player->doMove(passed ? NULL : &opponentsMove,
+                                           msLeft);
         if (playersMove != NULL) {                  
             cout << playersMove->x << " " << playersMove->y << endl;
         } else {
             cout << "-1 -1" << endl;
         }
+
+        record.opponent(moveX, moveY);
+        record.engine(playersMove ? playersMove->x : -1,
+                      playersMove ? playersMove->y : -1, player->bestScore,
+                      player->lastDepth, player->lastNodes, player->lastMs,
+                      msLeft);
         cout.flush();
         cerr.flush();
-        
-        // Delete move objects.
-        if (opponentsMove != NULL) delete opponentsMove;
-        if (playersMove != NULL) delete playersMove; 
     }
 
+    delete player;
+    delete brain;
+    delete mcts;
+    delete cluster;
     return 0;
 }